@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../huffman/huffman.hpp"
+#include "../huffman/info.hpp"
+#include "corpus/corpus.hpp"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+// Measures every phase of the codec on synthetic corpora, printing a JSON object per corpus and phase on its own line
+// The throughput is counted in decoded bytes (symbols) for every phase, so that the phases can be compared
+// The output is the size of the encoded messages, except for decoding
+namespace {
+	struct BenchOptions {
+		size_t size = 8 << 20;
+		size_t repeats = 5;
+		uint64_t seed = 1;
+		Huffman::EncodeOptions encode_options;
+		Huffman::DecodeOptions decode_options;
+	};
+
+	struct PhaseResult {
+		uint64_t output_size;
+		/// @brief The median of the repeats
+		double seconds;
+		/// @brief The peak resident set size during the phase in KiB, zero where it can't be measured
+		uint64_t peak_memory;
+	};
+
+	// Linux lets the peak resident set size be reset, so that it can be measured for every phase on its own
+	void reset_peak_memory() {
+#ifdef __linux__
+		std::ofstream clear_refs("/proc/self/clear_refs");
+		clear_refs << "5";
+#endif
+	}
+
+	uint64_t peak_memory() {
+#ifdef __linux__
+		std::ifstream status("/proc/self/status");
+		std::string line;
+
+		while(std::getline(status, line)) {
+			if(line.rfind("VmHWM:", 0) == 0) {
+				return std::stoull(line.substr(6));
+			}
+		}
+
+		// Without procfs only the peak of the whole process is known
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		return usage.ru_maxrss;
+#else
+		return 0;
+#endif
+	}
+
+	// Runs the phase `repeats` times, the function returns the size of its output
+	template <typename Function>
+	PhaseResult measure(size_t repeats, Function function) {
+		PhaseResult result;
+		std::vector<double> times;
+
+		reset_peak_memory();
+
+		for(size_t i = 0; i < repeats; i++) {
+			auto start = std::chrono::steady_clock::now();
+			result.output_size = function();
+			auto end = std::chrono::steady_clock::now();
+
+			times.push_back(std::chrono::duration<double>(end - start).count());
+		}
+
+		std::sort(times.begin(), times.end());
+		result.seconds = times[times.size() / 2];
+		result.peak_memory = peak_memory();
+
+		return result;
+	}
+
+	void print_result(const std::string& corpus, const std::string& phase, uint64_t input_size, const PhaseResult& result) {
+		double seconds = std::max(result.seconds, 1e-9);
+		char line[512];
+
+		std::snprintf(line, sizeof(line),
+			"{\"corpus\":\"%s\",\"phase\":\"%s\",\"input_bytes\":%llu,\"output_bytes\":%llu,\"seconds\":%.6f,"
+			"\"mb_per_s\":%.2f,\"ns_per_symbol\":%.3f,\"peak_rss_kib\":%llu}",
+			corpus.c_str(), phase.c_str(), static_cast<unsigned long long>(input_size), static_cast<unsigned long long>(result.output_size),
+			result.seconds, input_size / seconds / 1e6, seconds * 1e9 / std::max<uint64_t>(input_size, 1),
+			static_cast<unsigned long long>(result.peak_memory));
+
+		std::cout << line << std::endl;
+	}
+
+	// The tiny corpus is cut into messages, every other corpus is a single message
+	std::vector<Huffman::ByteSpan> split_messages(const std::vector<std::byte>& corpus, Bench::CorpusType type) {
+		size_t message_size = type == Bench::CorpusType::Tiny ? Bench::TINY_MESSAGE_SIZE : std::max<size_t>(corpus.size(), 1);
+		std::vector<Huffman::ByteSpan> result;
+
+		for(size_t offset = 0; offset < corpus.size(); offset += message_size) {
+			result.push_back(Huffman::ByteSpan(corpus.data() + offset, std::min(message_size, corpus.size() - offset)));
+		}
+
+		return result;
+	}
+
+	bool bench_corpus(Bench::CorpusType type, const BenchOptions& options) {
+		std::string name = Bench::corpus_name(type);
+		std::vector<std::byte> corpus = Bench::generate_corpus(type, options.size, options.seed);
+		std::vector<Huffman::ByteSpan> messages = split_messages(corpus, type);
+
+		// Counting and building the codes
+		PhaseResult tree = measure(options.repeats, [&]() -> uint64_t {
+			for(Huffman::ByteSpan message : messages) {
+				Huffman::train_dictionary(Huffman::histogram(message.data(), message.size()));
+			}
+
+			return 0;
+		});
+
+		print_result(name, "tree", corpus.size(), tree);
+
+		std::vector<std::vector<std::byte>> encoded(messages.size());
+
+		PhaseResult encode = measure(options.repeats, [&]() {
+			uint64_t result = 0;
+
+			for(size_t i = 0; i < messages.size(); i++) {
+				encoded[i].clear();
+
+				Huffman::VectorSink sink(encoded[i]);
+				Huffman::encode(messages[i], sink, options.encode_options);
+
+				result += encoded[i].size();
+			}
+
+			return result;
+		});
+
+		print_result(name, "encode", corpus.size(), encode);
+
+		std::vector<std::byte> decoded(corpus.size());
+
+		PhaseResult decode = measure(options.repeats, [&]() {
+			uint64_t result = 0;
+
+			for(size_t i = 0; i < messages.size(); i++) {
+				Huffman::MutableByteSpan output(decoded.data() + (messages[i].data() - corpus.data()), messages[i].size());
+				result += Huffman::decode(Huffman::ByteSpan(encoded[i].data(), encoded[i].size()), output, options.decode_options);
+			}
+
+			return result;
+		});
+
+		print_result(name, "decode", corpus.size(), decode);
+
+		if(decoded != corpus) {
+			std::cerr << "The " << name << " corpus doesn't decode to itself.\n";
+
+			return false;
+		}
+
+		// The corpora are generated from the same statistics throughout, so cutting them where the statistics change must not cost anything
+		if(options.encode_options.adaptive_blocks) {
+			Huffman::EncodeOptions fixed_options = options.encode_options;
+			fixed_options.adaptive_blocks = false;
+
+			for(size_t i = 0; i < messages.size(); i++) {
+				std::vector<std::byte> fixed;
+				Huffman::VectorSink sink(fixed);
+				Huffman::encode(messages[i], sink, fixed_options);
+
+				if(encoded[i].size() > fixed.size()) {
+					std::cerr << "The " << name << " corpus gets larger with adaptive blocks than with fixed ones.\n";
+
+					return false;
+				}
+			}
+		}
+
+		// Messages held in memory, as a whole
+		std::vector<Huffman::EncodedMessage> in_memory(messages.size());
+		std::vector<std::string> serialized(messages.size());
+
+		for(size_t i = 0; i < messages.size(); i++) {
+			std::istringstream input(std::string(reinterpret_cast<const char*>(messages[i].data()), messages[i].size()));
+			in_memory[i] = Huffman::encode(input, options.encode_options);
+		}
+
+		PhaseResult serialize = measure(options.repeats, [&]() {
+			uint64_t result = 0;
+
+			for(size_t i = 0; i < messages.size(); i++) {
+				std::ostringstream output;
+				in_memory[i].serialize(output);
+				serialized[i] = output.str();
+
+				result += serialized[i].size();
+			}
+
+			return result;
+		});
+
+		print_result(name, "serialize", corpus.size(), serialize);
+
+		PhaseResult deserialize = measure(options.repeats, [&]() {
+			uint64_t result = 0;
+
+			for(size_t i = 0; i < messages.size(); i++) {
+				std::istringstream input(serialized[i]);
+				in_memory[i] = Huffman::EncodedMessage::deserialize(input);
+
+				result += serialized[i].size();
+			}
+
+			return result;
+		});
+
+		print_result(name, "deserialize", corpus.size(), deserialize);
+
+		return true;
+	}
+
+	bool parse_options(int argc, const char* argv[], BenchOptions& options) {
+		for(int i = 1; i < argc; i++) {
+			std::string name = argv[i];
+
+			if(i + 1 == argc) {
+				return false;
+			}
+
+			uint64_t value;
+
+			try {
+				size_t parsed_chars;
+				value = std::stoull(argv[++i], &parsed_chars);
+
+				if(argv[i][parsed_chars] != '\0' || value == 0) {
+					return false;
+				}
+			} catch(const std::logic_error& e) {
+				return false;
+			}
+
+			if(name == "--size") {
+				options.size = value;
+			} else if(name == "--repeats") {
+				options.repeats = value;
+			} else if(name == "--seed") {
+				options.seed = value;
+			} else if(name == "--block-size") {
+				options.encode_options.block_size = value;
+			} else if(name == "--streams") {
+				options.encode_options.streams = value;
+			} else if(name == "--threads") {
+				options.encode_options.threads = value;
+				options.decode_options.threads = value;
+			} else {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	BenchOptions options;
+
+	if(!parse_options(argc, argv, options)) {
+		std::cerr << "Usage: hff-bench [--size <bytes>] [--repeats <n>] [--seed <n>] [--block-size <bytes>] [--streams <n>] [--threads <n>]\n";
+
+		return 1;
+	}
+
+	// The settings come first, so that results of different runs can be told apart
+	std::cout << "{\"version\":" << static_cast<uint32_t>(Huffman::CURRENT_VERSION) << ",\"size\":" << options.size
+		<< ",\"repeats\":" << options.repeats << ",\"seed\":" << options.seed << ",\"block_size\":" << options.encode_options.block_size
+		<< ",\"streams\":" << options.encode_options.streams << ",\"threads\":" << options.encode_options.threads << "}" << std::endl;
+
+	for(Bench::CorpusType type : Bench::CORPUS_TYPES) {
+		if(!bench_corpus(type, options)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Draws ranks with probabilities proportional to 1 / (rank + 1)^exponent
+	class ZipfSampler {
+		std::vector<double> m_Cumulative;
+
+	public:
+		ZipfSampler(size_t ranks, double exponent)
+			: m_Cumulative(ranks) {
+			double sum = 0;
+
+			for(size_t i = 0; i < ranks; i++) {
+				sum += 1.0 / std::pow(i + 1.0, exponent);
+				m_Cumulative[i] = sum;
+			}
+
+			for(double& value : m_Cumulative) {
+				value /= sum;
+			}
+		}
+
+		size_t sample(Bench::Random& random) const {
+			size_t result = std::upper_bound(m_Cumulative.begin(), m_Cumulative.end(), random.next_double()) - m_Cumulative.begin();
+
+			return std::min(result, m_Cumulative.size() - 1);
+		}
+	};
+
+	void generate_uniform(std::vector<std::byte>& output, size_t size, Bench::Random& random) {
+		while(output.size() < size) {
+			uint64_t word = random.next();
+
+			for(uint8_t i = 0; i < 8 && output.size() < size; i++) {
+				output.push_back(static_cast<std::byte>(word >> (8 * i)));
+			}
+		}
+	}
+
+	// The ranks are shuffled over the byte values, so that the frequent ones aren't all small
+	void generate_zipfian(std::vector<std::byte>& output, size_t size, Bench::Random& random) {
+		ZipfSampler sampler(256, 1.1);
+		std::array<uint8_t, 256> characters;
+
+		for(uint16_t i = 0; i < characters.size(); i++) {
+			characters[i] = i;
+		}
+
+		for(size_t i = characters.size() - 1; i > 0; i--) {
+			std::swap(characters[i], characters[random.next_below(i + 1)]);
+		}
+
+		while(output.size() < size) {
+			output.push_back(static_cast<std::byte>(characters[sampler.sample(random)]));
+		}
+	}
+
+	// Words are drawn from a vocabulary by Zipf's law, the letters of the vocabulary by their English frequencies
+	void generate_text(std::vector<std::byte>& output, size_t size, Bench::Random& random) {
+		const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+		const size_t vocabulary_size = 4096;
+		const size_t line_length = 72;
+
+		ZipfSampler letter_sampler(26, 1.0);
+		ZipfSampler word_sampler(vocabulary_size, 1.05);
+
+		std::vector<std::string> vocabulary(vocabulary_size);
+
+		for(std::string& word : vocabulary) {
+			size_t length = 1 + random.next_below(4) + random.next_below(6);
+
+			for(size_t i = 0; i < length; i++) {
+				word += letters[letter_sampler.sample(random)];
+			}
+		}
+
+		size_t line_start = 0;
+		bool sentence_start = true;
+
+		while(output.size() < size) {
+			std::string word = vocabulary[word_sampler.sample(random)];
+
+			if(sentence_start) {
+				word[0] = word[0] - 'a' + 'A';
+				sentence_start = false;
+			}
+
+			// Roughly every twelfth word ends a sentence, some with a comma in between
+			uint64_t ending = random.next_below(24);
+
+			if(ending < 2) {
+				word += '.';
+				sentence_start = true;
+			} else if(ending < 4) {
+				word += ',';
+			}
+
+			if(output.size() - line_start + word.size() >= line_length) {
+				output.push_back(std::byte('\n'));
+				line_start = output.size();
+			} else if(output.size() > line_start) {
+				output.push_back(std::byte(' '));
+			}
+
+			for(char character : word) {
+				output.push_back(static_cast<std::byte>(character));
+			}
+		}
+
+		output.resize(size);
+	}
+
+	// The number of significant bits of every integer is geometrically distributed
+	void generate_skewed_binary(std::vector<std::byte>& output, size_t size, Bench::Random& random) {
+		while(output.size() < size) {
+			uint8_t bits = 0;
+
+			while(bits < 32 && random.next_below(10) < 7) {
+				bits++;
+			}
+
+			uint32_t value = bits == 0 ? 0 : static_cast<uint32_t>(random.next() >> (64 - bits));
+
+			for(uint8_t i = 0; i < 4 && output.size() < size; i++) {
+				output.push_back(static_cast<std::byte>(value >> (8 * i)));
+			}
+		}
+	}
+}
+
+std::string Bench::corpus_name(CorpusType type) {
+	switch(type) {
+	case CorpusType::Uniform:
+		return "uniform";
+
+	case CorpusType::Zipfian:
+		return "zipfian";
+
+	case CorpusType::Text:
+		return "text";
+
+	case CorpusType::SkewedBinary:
+		return "skewed-binary";
+
+	case CorpusType::Tiny:
+		return "tiny";
+	}
+
+	return "unknown";
+}
+
+std::vector<std::byte> Bench::generate_corpus(CorpusType type, size_t size, uint64_t seed) {
+	std::vector<std::byte> result;
+	result.reserve(size);
+
+	Random random(seed);
+
+	switch(type) {
+	case CorpusType::Uniform:
+		generate_uniform(result, size, random);
+		break;
+
+	case CorpusType::Zipfian:
+		generate_zipfian(result, size, random);
+		break;
+
+	case CorpusType::Text:
+	case CorpusType::Tiny:
+		generate_text(result, size, random);
+		break;
+
+	case CorpusType::SkewedBinary:
+		generate_skewed_binary(result, size, random);
+		break;
+	}
+
+	return result;
+}
+
+Bench::Random::Random(uint64_t seed)
+	: m_State(seed) {}
+
+uint64_t Bench::Random::next() {
+	uint64_t result = (m_State += 0x9e3779b97f4a7c15);
+	result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9;
+	result = (result ^ (result >> 27)) * 0x94d049bb133111eb;
+
+	return result ^ (result >> 31);
+}
+
+double Bench::Random::next_double() {
+	return (next() >> 11) * (1.0 / (uint64_t(1) << 53));
+}
+
+uint64_t Bench::Random::next_below(uint64_t bound) {
+	return next() % bound;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bench {
+	enum class CorpusType {
+		/// @brief Every byte value equally likely, which can't be compressed
+		Uniform,
+		/// @brief Byte values with Zipfian frequencies
+		Zipfian,
+		/// @brief Words of a made up language, with sentences and lines
+		Text,
+		/// @brief Little-endian integers of mostly small magnitudes, so that most bytes are zero
+		SkewedBinary,
+		/// @brief Text cut into messages of a few hundred bytes, each encoded on its own
+		Tiny
+	};
+
+	const std::array<CorpusType, 5> CORPUS_TYPES = {
+		CorpusType::Uniform, CorpusType::Zipfian, CorpusType::Text, CorpusType::SkewedBinary, CorpusType::Tiny
+	};
+
+	/// @brief How long the messages of the tiny corpus are
+	const size_t TINY_MESSAGE_SIZE = 256;
+
+	std::string corpus_name(CorpusType type);
+
+	/// @brief Generates a synthetic corpus, the same one for the same arguments
+	/// Only the generator below is used, as the standard distributions differ between implementations
+	std::vector<std::byte> generate_corpus(CorpusType type, size_t size, uint64_t seed);
+
+	/// @brief The SplitMix64 generator, small and fully specified
+	class Random {
+		uint64_t m_State;
+
+	public:
+		explicit Random(uint64_t seed);
+
+		uint64_t next();
+		/// @brief A number in [0, 1)
+		double next_double();
+		/// @brief A number in [0, bound), bound has to be positive
+		uint64_t next_below(uint64_t bound);
+	};
+};
@@ -0,0 +1,56 @@
+#include "bitstream.hpp"
+
+#include <utility>
+
+Huffman::BitWriter::BitWriter(size_t reserve_bytes)
+	: m_Bytes(reserve_bytes + 8), m_BytesUsed(0), m_Accumulator(0), m_AccumulatorBits(0) {}
+
+uint64_t Huffman::BitWriter::get_length() const {
+	return m_BytesUsed * 8 + m_AccumulatorBits;
+}
+
+void Huffman::BitWriter::align() {
+	write(0, (8 - m_AccumulatorBits % 8) % 8);
+}
+
+void Huffman::BitWriter::flush_word() {
+	if(m_BytesUsed + 8 > m_Bytes.size()) {
+		m_Bytes.resize(m_Bytes.size() * 2);
+	}
+
+	// Stored byte by byte so as not to assume endianness, compilers turn it into a single swapped store
+	std::byte* output = m_Bytes.data() + m_BytesUsed;
+
+	for(uint8_t i = 0; i < 8; i++) {
+		output[i] = std::byte(m_Accumulator >> (56 - 8 * i));
+	}
+
+	m_BytesUsed += 8;
+}
+
+Huffman::Buffer Huffman::BitWriter::finish() {
+	uint64_t length = get_length();
+
+	// Left-align the pending bits and flush them as a (partial) word
+	if(m_AccumulatorBits > 0) {
+		m_Accumulator <<= 64 - m_AccumulatorBits;
+		flush_word();
+	}
+
+	Buffer result(std::move(m_Bytes), length);
+
+	m_Bytes = std::vector<std::byte>(8);
+	m_BytesUsed = 0;
+	m_Accumulator = 0;
+	m_AccumulatorBits = 0;
+
+	return result;
+}
+
+// Reader definitions
+Huffman::BitReader::BitReader(const std::byte* data, uint64_t length)
+	: m_Data(data), m_Size(length / 8 + (length % 8 > 0)), m_NextByte(0),
+	m_Window(0), m_WindowBits(0), m_Position(0), m_Length(length) {}
+
+Huffman::BitReader::BitReader(const Buffer& buffer)
+	: BitReader(buffer.data(), buffer.get_length()) {}
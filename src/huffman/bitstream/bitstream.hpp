@@ -0,0 +1,163 @@
+#pragma once
+
+#include "../buffer/buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Huffman {
+	/// @brief Appends bits to a byte vector through a 64-bit accumulator, flushing it a whole word at a time
+	/// Bits are stored in the same order as in `Buffer`, the first bit being the most significant one
+	class BitWriter {
+		std::vector<std::byte> m_Bytes;
+		/// @brief How many bytes of `m_Bytes` hold flushed words, the rest is reserved space
+		size_t m_BytesUsed;
+
+		uint64_t m_Accumulator;
+		/// @brief How many of the lowest bits of the accumulator are pending
+		uint8_t m_AccumulatorBits;
+
+	public:
+		/// @brief The longest code that can be written at once
+		static constexpr uint8_t MAX_WRITE_LENGTH = 57;
+
+		/// @param reserve_bytes How many bytes the output is expected to take
+		explicit BitWriter(size_t reserve_bytes = 0);
+
+		/// @brief Appends the lowest `length` bits of `bits`, the most significant one first
+		/// @param length At most `MAX_WRITE_LENGTH`
+		void write(uint64_t bits, uint8_t length) {
+			if(m_AccumulatorBits + length <= 64) {
+				m_Accumulator = (m_Accumulator << length) | bits;
+				m_AccumulatorBits += length;
+
+				return;
+			}
+
+			// Fill the accumulator up to a whole word, flush it and keep the rest of the bits
+			uint8_t rest = m_AccumulatorBits + length - 64;
+
+			m_Accumulator = (m_Accumulator << (length - rest)) | (bits >> rest);
+			flush_word();
+
+			m_Accumulator = bits & ((uint64_t(1) << rest) - 1);
+			m_AccumulatorBits = rest;
+		}
+
+		/// @brief How many bits were written so far
+		uint64_t get_length() const;
+
+		/// @brief Pads the written bits with zeroes up to a whole byte
+		void align();
+
+		/// @brief Flushes the pending bits and hands the written bits over as a buffer
+		Buffer finish();
+
+	private:
+		void flush_word();
+	};
+
+	/// @brief Reads bits from a byte array through a 64-bit window, refilled several bytes at a time
+	/// Bits are read in the same order as in `Buffer`, reading past the end yields zeroes
+	class BitReader {
+		const std::byte* m_Data;
+		size_t m_Size;
+		/// @brief The index of the first byte not loaded into the window yet
+		size_t m_NextByte;
+
+		/// @brief The upcoming bits, the next one being the most significant
+		uint64_t m_Window;
+		/// @brief How many of the highest bits of the window are valid
+		uint8_t m_WindowBits;
+
+		uint64_t m_Position;
+		uint64_t m_Length;
+
+	public:
+		/// @brief The most bits that can be peeked or read at once
+		static constexpr uint8_t MAX_READ_LENGTH = 57;
+
+		/// @param data The bytes to read
+		/// @param length How many bits of the data are meant to be read
+		BitReader(const std::byte* data, uint64_t length);
+		explicit BitReader(const Buffer& buffer);
+
+		/// @brief Looks at the upcoming bits without consuming them
+		/// @param count Between 1 and `MAX_READ_LENGTH`
+		/// @return The bits stored in the lowest bits of the result, the first one being the most significant
+		uint64_t peek(uint8_t count) {
+			if(m_WindowBits < count) {
+				refill();
+			}
+
+			return m_Window >> (64 - count);
+		}
+
+		/// @brief Skips bits, which have to be peeked first
+		void consume(uint8_t count) {
+			m_Window <<= count;
+			m_WindowBits -= count;
+			m_Position += count;
+		}
+
+		/// @param count Between 1 and `MAX_READ_LENGTH`
+		uint64_t read_bits(uint8_t count) {
+			uint64_t result = peek(count);
+			consume(count);
+
+			return result;
+		}
+
+		bool read_bit() {
+			return read_bits(1);
+		}
+
+		/// @brief How many bits were read so far
+		uint64_t get_position() const {
+			return m_Position;
+		}
+
+		/// @brief How many bits are left until the end of the given length, zero once it's reached or passed
+		uint64_t get_remaining() const {
+			return m_Position < m_Length ? m_Length - m_Position : 0;
+		}
+
+	private:
+		// Tops up the window to at least `MAX_READ_LENGTH` bits
+		void refill() {
+			if(m_NextByte + 8 <= m_Size) {
+				// Load a whole word and keep as many whole bytes of it as fit into the window
+				// The bits of the next, partially loaded byte are already in place and get loaded again later
+				// Spelled out rather than looped, which compilers turn into a single swapped load even without unrolling loops
+				const std::byte* bytes = m_Data + m_NextByte;
+				uint64_t word = std::to_integer<uint64_t>(bytes[0]) << 56 | std::to_integer<uint64_t>(bytes[1]) << 48
+					| std::to_integer<uint64_t>(bytes[2]) << 40 | std::to_integer<uint64_t>(bytes[3]) << 32
+					| std::to_integer<uint64_t>(bytes[4]) << 24 | std::to_integer<uint64_t>(bytes[5]) << 16
+					| std::to_integer<uint64_t>(bytes[6]) << 8 | std::to_integer<uint64_t>(bytes[7]);
+
+				m_Window |= word >> m_WindowBits;
+
+				uint8_t bytes_loaded = (64 - m_WindowBits) >> 3;
+				m_NextByte += bytes_loaded;
+				m_WindowBits += bytes_loaded * 8;
+
+				return;
+			}
+
+			refill_tail();
+		}
+
+		// Close to the end the bytes are loaded one by one
+		// Defined here like the rest of the reader, so that a reader kept in locals never has its address taken
+		void refill_tail() {
+			while(m_WindowBits <= 56) {
+				uint64_t byte = m_NextByte < m_Size ? std::to_integer<uint64_t>(m_Data[m_NextByte]) : 0;
+
+				m_Window |= byte << (56 - m_WindowBits);
+				m_NextByte++;
+				m_WindowBits += 8;
+			}
+		}
+	};
+};
@@ -3,6 +3,21 @@
 Huffman::Buffer::Buffer()
 	: m_Buffer(std::vector<std::byte>(1, std::byte(0))), m_LastByteLength(0) {}
 
+Huffman::Buffer::Buffer(std::vector<std::byte> bytes, uint64_t length)
+	: m_Buffer(std::move(bytes)), m_LastByteLength(length % 8 == 0 ? 8 : length % 8) {
+	if(length == 0) {
+		m_Buffer.assign(1, std::byte(0));
+		m_LastByteLength = 0;
+
+		return;
+	}
+
+	m_Buffer.resize(length / 8 + (length % 8 > 0));
+
+	// Clear the padding, so that equal contents compare equal
+	m_Buffer.back() &= std::byte(0xFF << (8 - m_LastByteLength));
+}
+
 void Huffman::Buffer::operator<<=(bool bit) {
 	if(m_LastByteLength == 8) {
 		m_Buffer.push_back(std::byte(bit) << 7);
@@ -41,14 +56,23 @@ Huffman::Buffer Huffman::Buffer::operator<<(std::byte byte) const {
 	return result;
 }
 
-void Huffman::Buffer::operator<<=(Buffer buffer) {
-	// TODO: There are quicker ways to do this (although more complicated)
-	for(auto it = buffer.bit_begin(); it != buffer.bit_end(); it++) {
-		*this <<= *it;
+void Huffman::Buffer::operator<<=(const Buffer& buffer) {
+	// Append whole bytes first, then the bits of the unfinished last byte
+	uint64_t length = buffer.get_length();
+	uint64_t complete_bytes = length / 8;
+
+	m_Buffer.reserve(m_Buffer.size() + complete_bytes + 1);
+
+	for(uint64_t i = 0; i < complete_bytes; i++) {
+		*this <<= buffer.m_Buffer[i];
+	}
+
+	for(uint8_t i = 0; i < length % 8; i++) {
+		*this <<= static_cast<bool>((buffer.m_Buffer[complete_bytes] >> (7 - i)) & std::byte(1));
 	}
 }
 
-Huffman::Buffer Huffman::Buffer::operator<<(Buffer buffer) const {
+Huffman::Buffer Huffman::Buffer::operator<<(const Buffer& buffer) const {
 	Buffer result = *this;
 
 	result <<= buffer;
@@ -91,6 +115,16 @@ uint64_t Huffman::Buffer::get_length() const {
 	return (m_Buffer.size() - 1) * 8 + m_LastByteLength;
 }
 
+uint64_t Huffman::Buffer::get_byte_length() const {
+	uint64_t length = get_length();
+
+	return length / 8 + (length % 8 > 0);
+}
+
+const std::byte* Huffman::Buffer::data() const {
+	return m_Buffer.data();
+}
+
 Huffman::Buffer::BitIterator Huffman::Buffer::bit_begin() const {
 	return BitIterator(m_Buffer.begin(), 0);
 }
@@ -135,7 +169,7 @@ Huffman::Buffer::BitIterator Huffman::Buffer::BitIterator::operator++(int) {
 }
 
 bool Huffman::Buffer::BitIterator::operator==(Huffman::Buffer::BitIterator other) const {
-	return std::distance(m_BufferIterator, other.m_BufferIterator) == 0 && m_BitIndex == other.m_BitIndex;
+	return m_BufferIterator == other.m_BufferIterator && m_BitIndex == other.m_BitIndex;
 }
 
 bool Huffman::Buffer::BitIterator::operator!=(Huffman::Buffer::BitIterator other) const {
@@ -143,38 +177,30 @@ bool Huffman::Buffer::BitIterator::operator!=(Huffman::Buffer::BitIterator other
 }
 
 bool Huffman::Buffer::BitIterator::operator*() const {
-	uint8_t num = (int)(*m_BufferIterator);
-
-	return (bool)((std::byte)(1 << (7 - m_BitIndex)) & (*m_BufferIterator));
+	return std::to_integer<uint8_t>(*m_BufferIterator >> (7 - m_BitIndex)) & 1;
 }
 
 std::byte Huffman::Buffer::BitIterator::next_byte_unsafe() {
-	// TODO: Optimize this to use two bytes and shifing instead of going over all bits seperately
-	std::byte byte = std::byte(0);
+	// The byte is put together from the rest of the current byte and the beginning of the next one
+	std::byte byte = *m_BufferIterator << m_BitIndex;
+
+	++m_BufferIterator;
 
-	for(uint8_t i = 0; i < 8; i++) {
-		byte |= std::byte(*(*this) << (7 - i));
-		++(*this);
+	if(m_BitIndex > 0) {
+		byte |= *m_BufferIterator >> (8 - m_BitIndex);
 	}
 
 	return byte;
 }
 
 std::byte Huffman::Buffer::BitIterator::next_byte(const BitIterator& end) {
-	// TODO: Optimize this to use two bytes and shifing instead of going over all bits seperately
-	std::byte byte = std::byte(0);
-
-	for(uint8_t i = 0; i < 8; i++) {
-		byte |= std::byte(*(*this) << (7 - i));
+	int64_t bits_left = (end.m_BufferIterator - m_BufferIterator) * 8 + end.m_BitIndex - m_BitIndex;
 
-		if(*this == end) {
-			throw IteratorEndReachedException();
-		}
-
-		++(*this);
+	if(bits_left < 8) {
+		throw IteratorEndReachedException();
 	}
 
-	return byte;
+	return next_byte_unsafe();
 }
 
 Huffman::Buffer::BitIterator::IteratorEndReachedException::IteratorEndReachedException() {
@@ -15,12 +15,15 @@ namespace Huffman {
 	public:
 		Buffer();
 
+		/// @brief Wraps raw bytes holding the given number of bits, the first bit being the most significant one
+		Buffer(std::vector<std::byte> bytes, uint64_t length);
+
 		Buffer operator<<(bool bit) const;
 		void operator<<=(bool bit);
 		Buffer operator<<(std::byte byte) const;
 		void operator<<=(std::byte byte);
-		Buffer operator<<(Buffer buffer) const;
-		void operator<<=(Buffer buffer);
+		Buffer operator<<(const Buffer& buffer) const;
+		void operator<<=(const Buffer& buffer);
 
 		void reserve_bytes(uint32_t bytes_num);
 
@@ -30,6 +33,10 @@ namespace Huffman {
 
 		uint64_t get_length() const;
 
+		/// @brief How many bytes the content takes, the last one being padded with zeroes
+		uint64_t get_byte_length() const;
+		const std::byte* data() const;
+
 		// Iterators through the stored data are the only way to access it
 		class BitIterator {
 			std::vector<std::byte>::const_iterator m_BufferIterator;
@@ -0,0 +1,185 @@
+#include "checksum.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HFF_CHECKSUM_SSE42
+#endif
+
+namespace {
+	// The Castagnoli polynomial, bit reversed like the checksum itself
+	const uint32_t POLYNOMIAL = 0x82F63B78;
+
+	// Table k holds the checksum of a byte followed by k zero bytes, so that eight bytes are looked up at once
+	using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+	Tables make_tables() {
+		Tables result;
+
+		for(uint32_t i = 0; i < 256; i++) {
+			uint32_t checksum = i;
+
+			for(uint8_t bit = 0; bit < 8; bit++) {
+				checksum = checksum & 1 ? (checksum >> 1) ^ POLYNOMIAL : checksum >> 1;
+			}
+
+			result[0][i] = checksum;
+		}
+
+		for(uint8_t k = 1; k < result.size(); k++) {
+			for(uint32_t i = 0; i < 256; i++) {
+				result[k][i] = (result[k - 1][i] >> 8) ^ result[0][result[k - 1][i] & 0xFF];
+			}
+		}
+
+		return result;
+	}
+
+	// This has to be done without reinterpret cast to not assume endianness
+	inline uint32_t load_uint32(const std::byte* data) {
+		return std::to_integer<uint32_t>(data[0]) | std::to_integer<uint32_t>(data[1]) << 8
+			| std::to_integer<uint32_t>(data[2]) << 16 | std::to_integer<uint32_t>(data[3]) << 24;
+	}
+
+	// The kernels work on the checksum inverted, as the CRC32C starts out from all ones and is inverted at the end
+	// Slicing-by-8: eight bytes are looked up in eight tables at once instead of one after another
+	uint32_t crc32c_scalar(uint32_t checksum, const std::byte* data, size_t size) {
+		static const Tables tables = make_tables();
+
+		size_t i = 0;
+
+		for(; i + 8 <= size; i += 8) {
+			uint32_t low = checksum ^ load_uint32(data + i);
+			uint32_t high = load_uint32(data + i + 4);
+
+			checksum = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+				^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+		}
+
+		for(; i < size; i++) {
+			checksum = (checksum >> 8) ^ tables[0][(checksum ^ std::to_integer<uint8_t>(data[i])) & 0xFF];
+		}
+
+		return checksum;
+	}
+
+#ifdef HFF_CHECKSUM_SSE42
+	// Long data is split into three streams worked out side by side, as the CRC32 instruction takes three cycles
+	// But a new one can start every cycle, the checksums of the streams are then put together with carry-less multiplication
+	const size_t STREAM_SIZE = 1 << 10;
+
+	// Multiplies two polynomials modulo the Castagnoli polynomial, all of them bit reversed
+	uint32_t multiply(uint32_t left, uint32_t right) {
+		uint32_t result = 0;
+
+		for(uint32_t bit = uint32_t(1) << 31; bit != 0; bit >>= 1) {
+			if(left & bit) {
+				result ^= right;
+			}
+
+			right = right & 1 ? (right >> 1) ^ POLYNOMIAL : right >> 1;
+		}
+
+		return result;
+	}
+
+	// x to the given power modulo the Castagnoli polynomial, bit reversed
+	uint32_t power(uint64_t exponent) {
+		uint32_t result = uint32_t(1) << 31;
+		uint32_t base = uint32_t(1) << 30;
+
+		for(; exponent > 0; exponent >>= 1) {
+			if(exponent & 1) {
+				result = multiply(result, base);
+			}
+
+			base = multiply(base, base);
+		}
+
+		return result;
+	}
+
+	__attribute__((target("sse4.2")))
+	uint32_t crc32c_sse42(uint32_t checksum, const std::byte* data, size_t size) {
+		uint64_t wide_checksum = checksum;
+		size_t i = 0;
+
+		for(; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+
+			wide_checksum = _mm_crc32_u64(wide_checksum, word);
+		}
+
+		checksum = wide_checksum;
+
+		for(; i < size; i++) {
+			checksum = _mm_crc32_u8(checksum, std::to_integer<uint8_t>(data[i]));
+		}
+
+		return checksum;
+	}
+
+	// Moves the checksum past as many zero bits as the multiplier was made for
+	// The product takes 64 bits, and the CRC32 instruction reduces it while multiplying it by another x^32
+	__attribute__((target("sse4.2,pclmul")))
+	inline uint32_t shift(uint32_t checksum, uint32_t multiplier) {
+		__m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(checksum)), _mm_cvtsi32_si128(static_cast<int>(multiplier)), 0);
+
+		return _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+	}
+
+	__attribute__((target("sse4.2,pclmul")))
+	uint32_t crc32c_pclmul(uint32_t checksum, const std::byte* data, size_t size) {
+		// The product is reflected one bit further and reduced with 32 more bits, which the powers make up for
+		static const uint32_t past_one_stream = power(STREAM_SIZE * 8 - 33);
+		static const uint32_t past_two_streams = power(STREAM_SIZE * 16 - 33);
+
+		for(; size >= 3 * STREAM_SIZE; data += 3 * STREAM_SIZE, size -= 3 * STREAM_SIZE) {
+			uint64_t first = checksum;
+			uint64_t second = 0;
+			uint64_t third = 0;
+
+			for(size_t i = 0; i < STREAM_SIZE; i += 8) {
+				uint64_t words[3];
+				std::memcpy(&words[0], data + i, 8);
+				std::memcpy(&words[1], data + STREAM_SIZE + i, 8);
+				std::memcpy(&words[2], data + 2 * STREAM_SIZE + i, 8);
+
+				first = _mm_crc32_u64(first, words[0]);
+				second = _mm_crc32_u64(second, words[1]);
+				third = _mm_crc32_u64(third, words[2]);
+			}
+
+			checksum = shift(first, past_two_streams) ^ shift(second, past_one_stream) ^ third;
+		}
+
+		return crc32c_sse42(checksum, data, size);
+	}
+#endif
+
+	using Kernel = uint32_t (*)(uint32_t, const std::byte*, size_t);
+
+	// Picks the fastest kernel the CPU supports
+	Kernel select_kernel() {
+#ifdef HFF_CHECKSUM_SSE42
+		if(__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) {
+			return crc32c_pclmul;
+		}
+
+		if(__builtin_cpu_supports("sse4.2")) {
+			return crc32c_sse42;
+		}
+#endif
+
+		return crc32c_scalar;
+	}
+}
+
+uint32_t Huffman::crc32c(const std::byte* data, size_t size, uint32_t checksum) {
+	static const Kernel kernel = select_kernel();
+
+	return ~kernel(~checksum, data, size);
+}
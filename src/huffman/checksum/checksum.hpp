@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Huffman {
+	/// @brief Computes the CRC32C (Castagnoli) checksum of the data, continuing the checksum of the data before it
+	/// Uses SSE4.2, along with PCLMUL for long data, if the CPU supports them, the result doesn't depend on it
+	/// @param checksum The checksum of the data right before `data`, zero to start a new one
+	uint32_t crc32c(const std::byte* data, size_t size, uint32_t checksum = 0);
+}
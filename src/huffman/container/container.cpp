@@ -0,0 +1,760 @@
+#include "container.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "../bitstream/bitstream.hpp"
+#include "../checksum/checksum.hpp"
+#include "../info.hpp"
+#include "../message/message.hpp"
+#include "../profile/profile.hpp"
+
+namespace {
+	// Bits of the flags byte following the version (since version 1)
+	const uint8_t CANONICAL_FLAG = 1 << 0;
+	const uint8_t SEEK_INDEX_FLAG = 1 << 1;
+	const uint8_t DICTIONARY_FLAG = 1 << 2;
+	const uint8_t STREAM_FLAG = 1 << 3;
+	const uint8_t CHECKSUMS_FLAG = 1 << 4;
+
+	// Bits of the flags byte starting every block (since version 2)
+	const uint8_t NEW_TREE_FLAG = 1 << 0;
+	const uint8_t RUN_FLAG = 1 << 1;
+	const uint8_t STREAMS_FLAG = 1 << 2;
+	const uint8_t CONTEXTS_FLAG = 1 << 3;
+	const uint8_t END_FLAG = 1 << 7;
+
+	// The first version made of blocks
+	const uint8_t BLOCK_CONTAINER_VERSION = 2;
+	// The first version storing the length of every block and supporting runs
+	const uint8_t BLOCK_LENGTH_VERSION = 4;
+	// The first version supporting blocks split into multiple streams
+	const uint8_t STREAMS_VERSION = 5;
+	// The first version supporting the seek index
+	const uint8_t SEEK_INDEX_VERSION = 6;
+	// The first version supporting dictionaries
+	const uint8_t DICTIONARY_VERSION = 7;
+	// The first version supporting messages written in a single pass
+	const uint8_t STREAM_VERSION = 8;
+	// The first version supporting blocks encoded with order-1 tables
+	const uint8_t CONTEXTS_VERSION = 9;
+	// The first version supporting block checksums
+	const uint8_t CHECKSUMS_VERSION = 10;
+
+	// The footer ends with the number of blocks and the closing characters
+	const uint8_t FOOTER_TAIL_SIZE = 8 + 2;
+
+	// Sizes read from a stream can't be checked against its length, so what they cover is read this much at a time
+	const uint64_t READ_CHUNK_SIZE = 1 << 20;
+
+	// Copies bits out of raw serialized content a word at a time
+	Huffman::Buffer extract_bits(Huffman::BitReader& input, uint64_t bits_num) {
+		Huffman::BitWriter output(bits_num / 8 + 1);
+
+		for(; bits_num >= Huffman::BitReader::MAX_READ_LENGTH; bits_num -= Huffman::BitReader::MAX_READ_LENGTH) {
+			output.write(input.read_bits(Huffman::BitReader::MAX_READ_LENGTH), Huffman::BitReader::MAX_READ_LENGTH);
+		}
+
+		if(bits_num > 0) {
+			output.write(input.read_bits(bits_num), bits_num);
+		}
+
+		return output.finish();
+	}
+
+	// Runs are stored without their content, so its checksum is worked out a piece at a time
+	uint32_t run_checksum(uint8_t character, uint64_t length) {
+		std::array<std::byte, 4096> piece;
+		piece.fill(std::byte(character));
+
+		uint32_t result = 0;
+
+		for(; length > 0; length -= std::min<uint64_t>(length, piece.size())) {
+			result = Huffman::crc32c(piece.data(), std::min<uint64_t>(length, piece.size()), result);
+		}
+
+		return result;
+	}
+}
+
+// Writer definitions
+Huffman::ContainerWriter::ContainerWriter(OutputSink& output, bool canonical, bool seek_index, std::optional<uint32_t> dictionary_id, bool stream,
+	bool checksums)
+	: m_Output(output), m_Canonical(canonical), m_SeekIndex(seek_index), m_Stream(stream), m_Checksums(checksums), m_HasTree(dictionary_id.has_value()),
+	m_BlockChecksum(0), m_BytesWritten(0), m_DecodedSize(0), m_BlocksWritten(0) {
+	// The seek index would have to be kept until the end
+	if(seek_index && stream) {
+		throw std::logic_error("A message written in a single pass can't have a seek index.");
+	}
+
+	// Header section
+	write("HFF", 3);
+	write_uint(Huffman::CURRENT_VERSION, 1);
+	write_uint((canonical ? CANONICAL_FLAG : 0) | (seek_index ? SEEK_INDEX_FLAG : 0) | (dictionary_id ? DICTIONARY_FLAG : 0) | (stream ? STREAM_FLAG : 0)
+		| (checksums ? CHECKSUMS_FLAG : 0), 1);
+
+	if(dictionary_id) {
+		write_uint(*dictionary_id, 4);
+	}
+}
+
+void Huffman::ContainerWriter::begin_block(uint64_t length) {
+	m_BlocksWritten++;
+	m_BlockChecksum = 0;
+
+	if(!m_Stream) {
+		m_BlockOffsets.push_back(m_BytesWritten);
+	}
+
+	if(m_SeekIndex) {
+		m_DecodedSize += length;
+		m_BlockEnds.push_back(m_DecodedSize);
+	}
+}
+
+void Huffman::ContainerWriter::end_block(std::optional<uint32_t> checksum) {
+	if(!m_Checksums) {
+		return;
+	}
+
+	if(!checksum) {
+		throw std::logic_error("Blocks written with checksums have to carry the checksum of their decoded content.");
+	}
+
+	// The checksum of the block covers everything from its flags up to here
+	uint32_t block_checksum = m_BlockChecksum;
+
+	write_uint(block_checksum, 4);
+	write_uint(*checksum, 4);
+}
+
+void Huffman::ContainerWriter::write_block(const Tree& huffman_tree, const EncodedMessage::Block& block) {
+	begin_block(block.length);
+	m_HasTree = true;
+
+	Buffer tree_buffer = m_Canonical ? huffman_tree.serialize_code_lengths() : huffman_tree.serialize();
+
+	write_uint(NEW_TREE_FLAG | (block.stream_lengths.empty() ? 0 : STREAMS_FLAG), 1);
+	write_uint(block.length, 8);
+	write_uint(tree_buffer.get_length(), 2);
+	write_buffer(tree_buffer);
+	write_message(block);
+	end_block(block.checksum);
+}
+
+void Huffman::ContainerWriter::write_block(const EncodedMessage::Block& block) {
+	if(!m_HasTree) {
+		throw std::logic_error("The first block which isn't a run has to carry a tree.");
+	}
+
+	begin_block(block.length);
+
+	write_uint(block.stream_lengths.empty() ? 0 : STREAMS_FLAG, 1);
+	write_uint(block.length, 8);
+	write_message(block);
+	end_block(block.checksum);
+}
+
+void Huffman::ContainerWriter::write_message(const EncodedMessage::Block& block) {
+	if(block.stream_lengths.empty()) {
+		write_uint(block.message_buffer.get_length(), 8);
+	} else {
+		write_uint(block.stream_lengths.size(), 1);
+
+		for(uint64_t stream_length : block.stream_lengths) {
+			write_uint(stream_length, 8);
+		}
+	}
+
+	write_buffer(block.message_buffer);
+}
+
+void Huffman::ContainerWriter::write_run(uint8_t character, uint64_t length) {
+	begin_block(length);
+
+	write_uint(RUN_FLAG, 1);
+	write_uint(length, 8);
+	write_uint(character, 1);
+	end_block(m_Checksums ? std::optional<uint32_t>(run_checksum(character, length)) : std::nullopt);
+}
+
+void Huffman::ContainerWriter::write_contexts_block(const EncodedMessage::Block& block) {
+	begin_block(block.length);
+
+	Buffer contexts_buffer = block.contexts->serialize();
+
+	write_uint(CONTEXTS_FLAG, 1);
+	write_uint(block.length, 8);
+	write_uint(contexts_buffer.get_length(), 2);
+	write_buffer(contexts_buffer);
+	write_message(block);
+	end_block(block.checksum);
+}
+
+void Huffman::ContainerWriter::finish() {
+	// Footer section
+	write_uint(END_FLAG, 1);
+
+	for(uint64_t offset : m_BlockOffsets) {
+		write_uint(offset, 8);
+	}
+
+	for(uint64_t end : m_BlockEnds) {
+		write_uint(end, 8);
+	}
+
+	write_uint(m_BlocksWritten, 8);
+	write("XX", 2);
+}
+
+void Huffman::ContainerWriter::flush() {
+	m_Output.flush();
+}
+
+uint64_t Huffman::ContainerWriter::get_bytes_written() const {
+	return m_BytesWritten;
+}
+
+void Huffman::ContainerWriter::write(const void* data, uint64_t size) {
+	m_Output.write(ByteSpan(static_cast<const std::byte*>(data), size));
+	m_BytesWritten += size;
+
+	if(m_Checksums) {
+		m_BlockChecksum = crc32c(static_cast<const std::byte*>(data), size, m_BlockChecksum);
+	}
+
+	HFF_PROFILE_COUNT(Counter::BytesOut, size);
+}
+
+void Huffman::ContainerWriter::write_uint(uint64_t value, uint8_t bytes_num) {
+	// This has to be done without reinterpret cast to not assume endianness
+	char bytes[8];
+
+	for(uint8_t i = 0; i < bytes_num; i++) {
+		bytes[i] = static_cast<char>(value >> (8 * i));
+	}
+
+	write(bytes, bytes_num);
+}
+
+void Huffman::ContainerWriter::write_buffer(const Buffer& buffer) {
+	write(buffer.data(), buffer.get_byte_length());
+}
+
+// Reader definitions
+Huffman::ContainerReader::ContainerReader(std::istream& input)
+	: m_Input(&input), m_Offset(0), m_SeekIndex(false), m_Stream(false), m_Checksums(false), m_Finished(false), m_HasTree(false), m_BlocksRead(0),
+	m_BlockChecksum(0) {
+	read_header();
+}
+
+Huffman::ContainerReader::ContainerReader(ByteSpan input)
+	: m_Input(nullptr), m_Bytes(input), m_Offset(0), m_SeekIndex(false), m_Stream(false), m_Checksums(false), m_Finished(false), m_HasTree(false),
+	m_BlocksRead(0), m_BlockChecksum(0) {
+	read_header();
+}
+
+void Huffman::ContainerReader::read_header() {
+	// Header section
+	char header_section[4];
+	read(header_section, 4);
+
+	std::string header = std::string() + header_section[0] + header_section[1] + header_section[2];
+
+	if(header != "HFF") {
+		throw EncodedMessage::InvalidHeaderException(header, "HFF");
+	}
+
+	// Older versions are still supported
+	m_Version = header_section[3];
+
+	if(m_Version > Huffman::CURRENT_VERSION) {
+		throw EncodedMessage::WrongVersionException(m_Version, Huffman::CURRENT_VERSION);
+	}
+
+	// Version 0 had no flags
+	uint8_t flags = m_Version >= 1 ? read_uint(1) : 0;
+
+	m_Canonical = flags & CANONICAL_FLAG;
+	m_SeekIndex = flags & SEEK_INDEX_FLAG && m_Version >= SEEK_INDEX_VERSION;
+	m_Stream = flags & STREAM_FLAG && m_Version >= STREAM_VERSION;
+	m_Checksums = flags & CHECKSUMS_FLAG && m_Version >= CHECKSUMS_VERSION;
+
+	// The dictionary stands in for a tree before the first block carrying one
+	if(flags & DICTIONARY_FLAG && m_Version >= DICTIONARY_VERSION) {
+		m_DictionaryId = read_uint(4);
+		m_HasTree = true;
+	}
+}
+
+uint8_t Huffman::ContainerReader::get_version() const {
+	return m_Version;
+}
+
+bool Huffman::ContainerReader::is_canonical() const {
+	return m_Canonical;
+}
+
+bool Huffman::ContainerReader::has_seek_index() const {
+	return m_SeekIndex;
+}
+
+std::optional<uint32_t> Huffman::ContainerReader::get_dictionary_id() const {
+	return m_DictionaryId;
+}
+
+bool Huffman::ContainerReader::is_stream() const {
+	return m_Stream;
+}
+
+bool Huffman::ContainerReader::has_checksums() const {
+	return m_Checksums;
+}
+
+uint64_t Huffman::ContainerReader::get_blocks_read() const {
+	return m_BlocksRead;
+}
+
+Huffman::BlockIndex Huffman::ContainerReader::read_index() {
+	if(m_Input != nullptr) {
+		throw std::logic_error("Only the index of a message held in memory can be read.");
+	}
+
+	BlockIndex result;
+
+	if(m_Version < BLOCK_CONTAINER_VERSION) {
+		return result;
+	}
+
+	// The footer is found from the end, by the number of blocks right before the closing characters
+	size_t header_end = m_Offset;
+
+	if(m_Bytes.size() < header_end + 1 + FOOTER_TAIL_SIZE) {
+		throw EncodedMessage::UnexpectedEofException();
+	}
+
+	m_Offset = m_Bytes.size() - FOOTER_TAIL_SIZE;
+	uint64_t block_count = read_uint(8);
+
+	char footer_bytes[2];
+	read(footer_bytes, 2);
+
+	if(footer_bytes[0] != 'X' || footer_bytes[1] != 'X') {
+		throw EncodedMessage::InvalidFooterException(std::string() + footer_bytes[0] + footer_bytes[1], "XX");
+	}
+
+	uint64_t index_size = m_Stream ? 0 : (m_SeekIndex ? 16 : 8);
+
+	// Every block takes at least a byte, which rules out counts too large to allocate
+	if(block_count > (m_Bytes.size() - header_end - 1 - FOOTER_TAIL_SIZE) / (index_size + 1)) {
+		throw EncodedMessage::InvalidBlockIndexException();
+	}
+
+	m_Offset = m_Bytes.size() - FOOTER_TAIL_SIZE - block_count * index_size;
+
+	uint64_t footer_begin = m_Offset - 1;
+
+	if(m_Stream) {
+		// Without offsets in the footer the blocks are read through, leaving their encoded messages in place
+		m_Offset = header_end;
+
+		std::optional<Tree> huffman_tree;
+		EncodedMessage::Block block;
+		MessageView message;
+
+		for(uint64_t i = 0; i < block_count; i++) {
+			result.block_offsets.push_back(m_Offset);
+
+			if(!read_block(huffman_tree, block, message)) {
+				throw EncodedMessage::InvalidBlockIndexException();
+			}
+		}
+
+		// The footer has to follow the last block
+		if(m_Offset != footer_begin) {
+			throw EncodedMessage::InvalidBlockIndexException();
+		}
+
+		m_HasTree = m_DictionaryId.has_value();
+		m_BlocksRead = 0;
+	}
+
+	for(uint64_t i = 0; !m_Stream && i < block_count; i++) {
+		result.block_offsets.push_back(read_uint(8));
+	}
+
+	for(uint64_t i = 0; m_SeekIndex && i < block_count; i++) {
+		result.block_ends.push_back(read_uint(8));
+	}
+
+	// The offsets have to point at consecutive blocks between the header and the footer
+	for(uint64_t i = 0; i < block_count; i++) {
+		uint64_t end = i + 1 < block_count ? result.block_offsets[i + 1] : footer_begin;
+
+		if(result.block_offsets[i] < header_end || result.block_offsets[i] >= end) {
+			throw EncodedMessage::InvalidBlockIndexException();
+		}
+	}
+
+	// Without the seek index the lengths are gathered from the headers of the blocks, if they're stored there
+	if(!m_SeekIndex && m_Version >= BLOCK_LENGTH_VERSION) {
+		uint64_t decoded_size = 0;
+
+		for(uint64_t offset : result.block_offsets) {
+			m_Offset = offset + 1;
+			decoded_size += read_uint(8);
+
+			result.block_ends.push_back(decoded_size);
+		}
+	}
+
+	for(uint64_t i = 1; i < result.block_ends.size(); i++) {
+		if(result.block_ends[i] < result.block_ends[i - 1]) {
+			throw EncodedMessage::InvalidBlockIndexException();
+		}
+	}
+
+	m_Offset = header_end;
+
+	return result;
+}
+
+size_t Huffman::ContainerReader::seek_block(const BlockIndex& index, size_t block) {
+	if(m_Input != nullptr) {
+		throw std::logic_error("Only a message held in memory can be read from any block.");
+	}
+
+	// Runs don't affect which tree the blocks after them reuse, so they're skipped looking for the tree
+	size_t result = block;
+
+	while(true) {
+		uint8_t flags = std::to_integer<uint8_t>(m_Bytes[index.block_offsets[result]]);
+		bool run = flags & RUN_FLAG && m_Version >= BLOCK_LENGTH_VERSION;
+		bool contexts = flags & CONTEXTS_FLAG && m_Version >= CONTEXTS_VERSION;
+
+		// Blocks with order-1 tables are skipped like runs
+		if((result == block && (run || contexts)) || (flags & NEW_TREE_FLAG && !contexts)) {
+			break;
+		}
+
+		// Without a tree before it the block reuses the dictionary, so it can be read right away
+		if(result == 0) {
+			if(!m_DictionaryId) {
+				throw EncodedMessage::InvalidTreeDataException();
+			}
+
+			result = block;
+			break;
+		}
+
+		result--;
+	}
+
+	m_Offset = index.block_offsets[result];
+	m_BlocksRead = result;
+	m_HasTree = m_DictionaryId.has_value();
+	m_Finished = false;
+
+	return result;
+}
+
+bool Huffman::ContainerReader::read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block) {
+	return read_block(huffman_tree, block, nullptr);
+}
+
+bool Huffman::ContainerReader::read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block, MessageView& message) {
+	if(m_Input != nullptr) {
+		throw std::logic_error("Only messages held in memory can be read in place.");
+	}
+
+	return read_block(huffman_tree, block, &message);
+}
+
+bool Huffman::ContainerReader::read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block, MessageView* message) {
+	if(m_Finished) {
+		return false;
+	}
+
+	HFF_PROFILE_PHASE(Phase::Deserialize, m_BlocksRead);
+
+	block.length = EncodedMessage::Block::UNKNOWN_LENGTH;
+	block.run = false;
+	block.run_character = 0;
+	block.stream_lengths.clear();
+	block.contexts.reset();
+	block.checksum.reset();
+
+	if(message != nullptr) {
+		message->bytes = ByteSpan();
+		message->stream_lengths.clear();
+	}
+
+	if(m_Version < BLOCK_CONTAINER_VERSION) {
+		read_legacy_block(huffman_tree, block);
+		m_BlocksRead++;
+
+		if(message != nullptr) {
+			message->bytes = ByteSpan(block.message_buffer.data(), block.message_buffer.get_byte_length());
+			message->stream_lengths.push_back(block.message_buffer.get_length());
+		}
+
+		return true;
+	}
+
+	m_BlockChecksum = 0;
+	uint8_t flags = read_uint(1);
+
+	if(flags & END_FLAG) {
+		read_footer();
+
+		return false;
+	}
+
+	if(m_Version >= BLOCK_LENGTH_VERSION) {
+		block.length = read_uint(8);
+	}
+
+	huffman_tree.reset();
+
+	// Runs need neither a tree nor an encoded message
+	if(flags & RUN_FLAG && m_Version >= BLOCK_LENGTH_VERSION) {
+		block.run = true;
+		block.run_character = read_uint(1);
+		block.message_buffer = Buffer();
+
+		read_checksums(block);
+		m_BlocksRead++;
+
+		return true;
+	}
+
+	// The tree or the order-1 tables are only made out of their data once the block is known to be intact
+	bool contexts = flags & CONTEXTS_FLAG && m_Version >= CONTEXTS_VERSION;
+	bool new_tree = !contexts && flags & NEW_TREE_FLAG;
+	Buffer tables_buffer;
+
+	if(contexts || new_tree) {
+		uint16_t tables_size = read_uint(2);
+		tables_buffer = read_buffer(tables_size);
+	} else if(!m_HasTree) {
+		throw EncodedMessage::InvalidTreeDataException();
+	}
+
+	// The streams of a block are stored one after another, each padded to whole bytes
+	uint64_t message_size;
+
+	if(flags & STREAMS_FLAG && m_Version >= STREAMS_VERSION) {
+		uint8_t streams_num = read_uint(1);
+		uint64_t message_bytes = 0;
+
+		for(uint8_t i = 0; i < streams_num; i++) {
+			uint64_t stream_length = read_uint(8);
+
+			block.stream_lengths.push_back(stream_length);
+			message_bytes += stream_length / 8 + (stream_length % 8 > 0);
+		}
+
+		message_size = message_bytes * 8;
+	} else {
+		message_size = read_uint(8);
+	}
+
+	// Blocks of unknown length are decoded from their buffer, so they're still copied
+	if(message == nullptr || block.length == EncodedMessage::Block::UNKNOWN_LENGTH) {
+		block.message_buffer = read_buffer(message_size);
+
+		if(message != nullptr) {
+			message->bytes = ByteSpan(block.message_buffer.data(), block.message_buffer.get_byte_length());
+		}
+	} else {
+		block.message_buffer = Buffer();
+		message->bytes = read_view(message_size / 8 + (message_size % 8 > 0));
+	}
+
+	if(message != nullptr) {
+		if(block.stream_lengths.empty()) {
+			message->stream_lengths.push_back(message_size);
+		} else {
+			message->stream_lengths = block.stream_lengths;
+		}
+	}
+
+	read_checksums(block);
+
+	// Blocks with order-1 tables stand on their own, the blocks after them reuse the tree from before them
+	if(contexts) {
+		block.contexts = read_contexts(tables_buffer);
+	} else if(new_tree) {
+		huffman_tree = read_tree(tables_buffer);
+		m_HasTree = true;
+	}
+
+	m_BlocksRead++;
+
+	return true;
+}
+
+void Huffman::ContainerReader::read_legacy_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block) {
+	// Content section, the tree and the message follow each other without padding
+	uint16_t tree_size = read_uint(2);
+	uint32_t message_size = read_uint(4);
+
+	uint64_t content_buffer_bits_num = static_cast<uint64_t>(tree_size) + message_size;
+	uint64_t content_buffer_bytes_num = content_buffer_bits_num / 8 + (content_buffer_bits_num % 8 > 0);
+
+	std::vector<std::byte> content = read_bytes(content_buffer_bytes_num);
+
+	BitReader content_reader(content.data(), content_buffer_bits_num);
+
+	huffman_tree = read_tree(extract_bits(content_reader, tree_size));
+	block.message_buffer = extract_bits(content_reader, message_size);
+
+	// Footer section
+	char footer_bytes[2];
+	read(footer_bytes, 2);
+
+	if(footer_bytes[0] != 'X' || footer_bytes[1] != 'X') {
+		throw EncodedMessage::InvalidFooterException(std::string() + footer_bytes[0] + footer_bytes[1], "XX");
+	}
+
+	m_Finished = true;
+}
+
+void Huffman::ContainerReader::read_footer() {
+	// The block index is only needed for random access, here it's just skipped
+	for(uint64_t i = 0; !m_Stream && i < m_BlocksRead * (m_SeekIndex ? 2 : 1); i++) {
+		read_uint(8);
+	}
+
+	uint64_t block_count = read_uint(8);
+
+	if(block_count != m_BlocksRead) {
+		throw EncodedMessage::InvalidBlockIndexException();
+	}
+
+	char footer_bytes[2];
+	read(footer_bytes, 2);
+
+	if(footer_bytes[0] != 'X' || footer_bytes[1] != 'X') {
+		throw EncodedMessage::InvalidFooterException(std::string() + footer_bytes[0] + footer_bytes[1], "XX");
+	}
+
+	m_Finished = true;
+}
+
+void Huffman::ContainerReader::read_checksums(EncodedMessage::Block& block) {
+	if(!m_Checksums) {
+		return;
+	}
+
+	// The checksum of the block covers everything from its flags up to here
+	uint32_t block_checksum = m_BlockChecksum;
+
+	if(read_uint(4) != block_checksum) {
+		throw EncodedMessage::ChecksumMismatchException(m_BlocksRead);
+	}
+
+	block.checksum = read_uint(4);
+}
+
+Huffman::Tree Huffman::ContainerReader::read_tree(const Buffer& tree_buffer) const {
+	try {
+		return m_Canonical
+			? Tree::from_code_lengths(Tree::deserialize_code_lengths(tree_buffer))
+			: Tree::deserialize(tree_buffer);
+	} catch(const Tree::DeserializationException& e) {
+		throw EncodedMessage::InvalidTreeDataException();
+	}
+}
+
+std::shared_ptr<const Huffman::ContextModel> Huffman::ContainerReader::read_contexts(const Buffer& contexts_buffer) const {
+	try {
+		return std::make_shared<const ContextModel>(ContextModel::deserialize(contexts_buffer));
+	} catch(const ContextModel::InvalidContextsException& e) {
+		throw EncodedMessage::InvalidTreeDataException();
+	}
+}
+
+void Huffman::ContainerReader::read(void* data, uint64_t size) {
+	HFF_PROFILE_COUNT(Counter::BytesIn, size);
+
+	if(m_Input == nullptr) {
+		if(size > m_Bytes.size() - m_Offset) {
+			throw EncodedMessage::UnexpectedEofException();
+		}
+
+		std::memcpy(data, m_Bytes.data() + m_Offset, size);
+		m_Offset += size;
+	} else {
+		m_Input->read(static_cast<char*>(data), size);
+
+		if(m_Input->eof()) {
+			throw EncodedMessage::UnexpectedEofException();
+		}
+	}
+
+	if(m_Checksums) {
+		m_BlockChecksum = crc32c(static_cast<const std::byte*>(data), size, m_BlockChecksum);
+	}
+}
+
+uint64_t Huffman::ContainerReader::read_uint(uint8_t bytes_num) {
+	char bytes[8];
+	read(bytes, bytes_num);
+
+	uint64_t result = 0;
+
+	for(uint8_t i = 0; i < bytes_num; i++) {
+		result |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+	}
+
+	return result;
+}
+
+Huffman::ByteSpan Huffman::ContainerReader::read_view(uint64_t bytes_num) {
+	if(bytes_num > m_Bytes.size() - m_Offset) {
+		throw EncodedMessage::UnexpectedEofException();
+	}
+
+	ByteSpan result = m_Bytes.subspan(m_Offset, bytes_num);
+	m_Offset += bytes_num;
+
+	if(m_Checksums) {
+		m_BlockChecksum = crc32c(result.data(), result.size(), m_BlockChecksum);
+	}
+
+	HFF_PROFILE_COUNT(Counter::BytesIn, bytes_num);
+
+	return result;
+}
+
+Huffman::Buffer Huffman::ContainerReader::read_buffer(uint64_t bits_num) {
+	uint64_t bytes_num = bits_num / 8 + (bits_num % 8 > 0);
+
+	// Messages held in memory are copied straight into the buffer, without zeroing it first
+	if(m_Input == nullptr) {
+		ByteSpan view = read_view(bytes_num);
+
+		return Buffer(std::vector<std::byte>(view.begin(), view.end()), bits_num);
+	}
+
+	return Buffer(read_bytes(bytes_num), bits_num);
+}
+
+std::vector<std::byte> Huffman::ContainerReader::read_bytes(uint64_t bytes_num) {
+	// A corrupted size then runs into the end of the input instead of allocating all of it up front
+	std::vector<std::byte> result;
+
+	while(result.size() < bytes_num) {
+		size_t offset = result.size();
+
+		result.resize(offset + std::min(bytes_num - offset, READ_CHUNK_SIZE));
+		read(result.data() + offset, result.size() - offset);
+	}
+
+	return result;
+}
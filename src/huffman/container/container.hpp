@@ -0,0 +1,179 @@
+#pragma once
+
+#include "../buffer/buffer.hpp"
+#include "../message/message.hpp"
+#include "../sink/sink.hpp"
+#include "../span/span.hpp"
+#include "../tree/tree.hpp"
+
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace Huffman {
+	/// @brief Writes the block container format one block at a time
+	class ContainerWriter {
+		OutputSink& m_Output;
+		bool m_Canonical;
+		bool m_SeekIndex;
+		/// @brief Whether the message is written in a single pass, keeping nothing about the blocks written
+		bool m_Stream;
+		bool m_Checksums;
+		bool m_HasTree;
+
+		/// @brief The checksum of the block being written so far
+		uint32_t m_BlockChecksum;
+		/// @brief How many bytes were written so far, used to build the block index
+		uint64_t m_BytesWritten;
+		std::vector<uint64_t> m_BlockOffsets;
+		/// @brief Where the decoded content of every block ends, gathered only for the seek index
+		std::vector<uint64_t> m_BlockEnds;
+		uint64_t m_DecodedSize;
+		uint64_t m_BlocksWritten;
+
+	public:
+		/// @brief Writes the header section
+		/// @param canonical Whether the trees hold canonical codes, in which case only their code lengths are serialized
+		/// @param seek_index Whether to store where the decoded content of every block ends, so that any range can be found without reading the blocks
+		/// @param dictionary_id The ID of the dictionary the blocks are encoded with, in which case blocks don't need a tree of their own
+		/// @param stream Whether to leave the block offsets out of the footer, so that memory use doesn't grow with the number of blocks
+		/// @param checksums Whether to follow every block with the checksums of its stored and decoded content, every block which isn't a run
+		/// has to carry the checksum of its decoded content then
+		ContainerWriter(OutputSink& output, bool canonical, bool seek_index = false, std::optional<uint32_t> dictionary_id = std::nullopt, bool stream = false,
+			bool checksums = false);
+
+		/// @brief Writes a block encoded with a new tree
+		/// @param block The encoded content of the block, its tree index is ignored
+		void write_block(const Tree& huffman_tree, const EncodedMessage::Block& block);
+
+		/// @brief Writes a block encoded with the same tree as the last block which wasn't a run
+		void write_block(const EncodedMessage::Block& block);
+
+		/// @brief Writes a block made of a single character repeated `length` times
+		void write_run(uint8_t character, uint64_t length);
+
+		/// @brief Writes a block encoded with its own order-1 tables, which it stores along with it
+		void write_contexts_block(const EncodedMessage::Block& block);
+
+		/// @brief Writes the block index and the footer section, no blocks can be written afterwards
+		void finish();
+
+		/// @brief Passes everything written so far on to the output, so that the blocks can be decoded before the message is finished
+		void flush();
+
+		uint64_t get_bytes_written() const;
+
+	private:
+		void write(const void* data, uint64_t size);
+		void write_uint(uint64_t value, uint8_t bytes_num);
+		void write_buffer(const Buffer& buffer);
+		// Writes the encoded message of a block, preceded by its length or the lengths of its streams
+		void write_message(const EncodedMessage::Block& block);
+		// Records where a new block starts
+		void begin_block(uint64_t length);
+		// Writes the checksums following the block, if the message stores them
+		void end_block(std::optional<uint32_t> checksum);
+	};
+
+	/// @brief The encoded message of a block, left in place within the serialized message
+	struct MessageView {
+		/// @brief The streams of the message one after another, each starting at a byte boundary
+		ByteSpan bytes;
+		/// @brief The length of every stream in bits, a single one if the block isn't split into streams
+		std::vector<uint64_t> stream_lengths;
+	};
+
+	/// @brief Where the blocks of a message start in the message and in its decoded content
+	struct BlockIndex {
+		/// @brief The offset of every block in bytes from the start of the message
+		std::vector<uint64_t> block_offsets;
+		/// @brief Where the decoded content of every block ends, empty if the blocks of the message don't store their length
+		std::vector<uint64_t> block_ends;
+	};
+
+	/// @brief Reads serialized messages one block at a time
+	/// Messages of versions preceding the block container are read as a single block
+	class ContainerReader {
+		/// @brief The stream the message is read from, null if it's read from `m_Bytes` instead
+		std::istream* m_Input;
+		ByteSpan m_Bytes;
+		/// @brief How many bytes of `m_Bytes` were read so far
+		size_t m_Offset;
+
+		uint8_t m_Version;
+		bool m_Canonical;
+		bool m_SeekIndex;
+		bool m_Stream;
+		bool m_Checksums;
+		std::optional<uint32_t> m_DictionaryId;
+		bool m_Finished;
+		bool m_HasTree;
+		uint64_t m_BlocksRead;
+		/// @brief The checksum of the block being read so far
+		uint32_t m_BlockChecksum;
+
+	public:
+		/// @brief Reads the header section
+		ContainerReader(std::istream& input);
+
+		/// @brief Reads the header section of a message held in memory, which has to outlive the reader
+		explicit ContainerReader(ByteSpan input);
+
+		uint8_t get_version() const;
+		bool is_canonical() const;
+		bool has_seek_index() const;
+		/// @brief The ID of the dictionary the message was encoded with, if any
+		std::optional<uint32_t> get_dictionary_id() const;
+		/// @brief Whether the message was written in a single pass, without the block offsets in its footer
+		bool is_stream() const;
+		/// @brief Whether every block is followed by the checksums of its stored and decoded content
+		bool has_checksums() const;
+		/// @brief How many blocks were read so far, including the ones skipped by seeking
+		uint64_t get_blocks_read() const;
+
+		/// @brief Reads the block index of a message held in memory from its footer
+		/// Where the blocks end in the decoded content is taken from the seek index, or from the headers of the blocks if there's none
+		/// The blocks of messages written in a single pass are found by reading through them
+		/// Messages of versions preceding the block container have no index, an empty one is returned
+		BlockIndex read_index();
+
+		/// @brief Moves a reader of a message held in memory to the given block, the next block read being the first one with a tree at or before it
+		/// Blocks reusing a tree can only be decoded after the block carrying it, so reading has to start there
+		/// Blocks of messages encoded with a dictionary reuse its tree unless there's a tree before them
+		/// @return The index of the block the reader was moved to
+		size_t seek_block(const BlockIndex& index, size_t block);
+
+		/// @brief Reads the next block, checking it against its checksum first if the message stores checksums
+		/// @param huffman_tree Set to the tree of the block, or emptied if the block reuses the previous tree, is a run or carries order-1 tables
+		/// @param block Set to the content of the block along with the checksum of its decoded content, its tree index is left for the caller to fill in
+		/// @return False if there are no more blocks, in which case the footer has been verified
+		bool read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block);
+
+		/// @brief Reads the next block of a message held in memory, without copying its encoded message
+		/// The encoded message of the block is left empty, `message` points into the input instead
+		/// Only blocks of versions which didn't store their length are still copied, `message` pointing into the block then
+		/// @return False if there are no more blocks, in which case the footer has been verified
+		bool read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block, MessageView& message);
+
+	private:
+		void read_header();
+		// Reads the block, leaving its encoded message in place if `message` isn't null
+		bool read_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block, MessageView* message);
+		// Reads the only block of a version 0 or 1 message
+		void read_legacy_block(std::optional<Tree>& huffman_tree, EncodedMessage::Block& block);
+		void read_footer();
+		// Checks the block read so far against its checksum and reads the checksum of its decoded content
+		void read_checksums(EncodedMessage::Block& block);
+
+		Tree read_tree(const Buffer& tree_buffer) const;
+		std::shared_ptr<const ContextModel> read_contexts(const Buffer& contexts_buffer) const;
+		void read(void* data, uint64_t size);
+		uint64_t read_uint(uint8_t bytes_num);
+		Buffer read_buffer(uint64_t bits_num);
+		std::vector<std::byte> read_bytes(uint64_t bytes_num);
+		// Skips the bytes of a message held in memory, returning a view of them
+		ByteSpan read_view(uint64_t bytes_num);
+	};
+};
@@ -0,0 +1,212 @@
+#include "context.hpp"
+
+#include "../bitstream/bitstream.hpp"
+
+#include <algorithm>
+
+namespace {
+	// Bits of the serialized model
+	const uint8_t TABLES_NUM_BITS = 4;
+	const uint8_t CHARACTER_BITS = 8;
+	const uint8_t CODE_LENGTH_BITS = 4;
+
+	static_assert(Huffman::ContextModel::MAX_TABLES <= 1 << TABLES_NUM_BITS, "The number of tables has to fit its field");
+	static_assert(Huffman::ContextModel::MAX_CODE_LENGTH < 1 << CODE_LENGTH_BITS, "Code lengths have to fit their field");
+
+	// How many bits the index of a table takes in the context map
+	uint8_t table_index_bits(size_t tables_num) {
+		uint8_t result = 0;
+
+		while((size_t(1) << result) < tables_num) {
+			result++;
+		}
+
+		return result;
+	}
+
+	// The lengths of a table are stored as (character, length) pairs if that's shorter than all 256 of them
+	bool is_sparse(uint16_t character_count) {
+		return character_count * (CHARACTER_BITS + CODE_LENGTH_BITS) < 256 * CODE_LENGTH_BITS;
+	}
+
+	uint64_t read_bits_checked(Huffman::BitReader& input, uint8_t count) {
+		if(input.get_remaining() < count) {
+			throw Huffman::ContextModel::InvalidContextsException();
+		}
+
+		return count > 0 ? input.read_bits(count) : 0;
+	}
+
+	std::vector<Huffman::Tree::CodeTable> make_code_tables(const std::vector<Huffman::Tree::CodeLengths>& code_lengths) {
+		std::vector<Huffman::Tree::CodeTable> result;
+		result.reserve(code_lengths.size());
+
+		for(const Huffman::Tree::CodeLengths& lengths : code_lengths) {
+			for(uint8_t length : lengths) {
+				if(length > Huffman::ContextModel::MAX_CODE_LENGTH) {
+					throw Huffman::ContextModel::InvalidContextsException();
+				}
+			}
+
+			try {
+				result.push_back(Huffman::Tree::from_code_lengths(lengths).get_code_table());
+			} catch(const Huffman::Tree::DeserializationException& e) {
+				throw Huffman::ContextModel::InvalidContextsException();
+			}
+		}
+
+		return result;
+	}
+}
+
+Huffman::ContextModel::ContextModel(const ContextMap& context_map, const std::vector<Tree::CodeLengths>& code_lengths)
+	: m_ContextMap(context_map), m_CodeLengths(code_lengths) {
+	if(code_lengths.empty() || code_lengths.size() > MAX_TABLES) {
+		throw InvalidContextsException();
+	}
+
+	for(uint8_t table : context_map) {
+		if(table >= code_lengths.size()) {
+			throw InvalidContextsException();
+		}
+	}
+
+	m_CodeTables = make_code_tables(code_lengths);
+	m_DecodeTables.reserve(code_lengths.size());
+
+	for(const Tree::CodeLengths& lengths : code_lengths) {
+		m_DecodeTables.emplace_back(lengths);
+	}
+}
+
+const Huffman::ContextModel::ContextMap& Huffman::ContextModel::get_context_map() const {
+	return m_ContextMap;
+}
+
+const std::vector<Huffman::Tree::CodeLengths>& Huffman::ContextModel::get_code_lengths() const {
+	return m_CodeLengths;
+}
+
+Huffman::Buffer Huffman::ContextModel::encode(ByteSpan block, uint64_t encoded_size) const {
+	BitWriter writer(encoded_size / 8 + 1);
+	uint8_t previous = 0;
+
+	for(std::byte character : block) {
+		uint8_t current = std::to_integer<uint8_t>(character);
+		const Tree::CodeWord& code = m_CodeTables[m_ContextMap[previous]][current];
+
+		writer.write(code.bits, code.length);
+		previous = current;
+	}
+
+	return writer.finish();
+}
+
+bool Huffman::ContextModel::decode(ByteSpan input, uint64_t length, MutableByteSpan output) const {
+	if(length > input.size() * 8) {
+		return false;
+	}
+
+	BitReader reader(input.data(), length);
+	uint8_t previous = 0;
+
+	// Every lookup depends on the character decoded before it, so a lookup resolves a single character
+	for(std::byte& character : output) {
+		if(!m_DecodeTables[m_ContextMap[previous]].decode_symbol(reader, previous)) {
+			return false;
+		}
+
+		character = std::byte(previous);
+	}
+
+	return reader.get_remaining() == 0;
+}
+
+Huffman::Buffer Huffman::ContextModel::serialize() const {
+	BitWriter writer;
+	uint8_t index_bits = table_index_bits(m_CodeLengths.size());
+
+	writer.write(m_CodeLengths.size() - 1, TABLES_NUM_BITS);
+
+	for(uint8_t table : m_ContextMap) {
+		if(index_bits > 0) {
+			writer.write(table, index_bits);
+		}
+	}
+
+	for(const Tree::CodeLengths& lengths : m_CodeLengths) {
+		uint16_t character_count = std::count_if(lengths.begin(), lengths.end(), [](uint8_t length) {
+			return length > 0;
+		});
+
+		bool sparse = is_sparse(character_count);
+		writer.write(sparse, 1);
+
+		if(sparse) {
+			writer.write(character_count - 1, CHARACTER_BITS);
+		}
+
+		for(uint16_t character = 0; character < lengths.size(); character++) {
+			if(!sparse) {
+				writer.write(lengths[character], CODE_LENGTH_BITS);
+			} else if(lengths[character] > 0) {
+				writer.write(character, CHARACTER_BITS);
+				writer.write(lengths[character], CODE_LENGTH_BITS);
+			}
+		}
+	}
+
+	return writer.finish();
+}
+
+Huffman::ContextModel Huffman::ContextModel::deserialize(const Buffer& buffer) {
+	BitReader input(buffer);
+
+	size_t tables_num = read_bits_checked(input, TABLES_NUM_BITS) + 1;
+	uint8_t index_bits = table_index_bits(tables_num);
+
+	ContextMap context_map;
+
+	for(uint8_t& table : context_map) {
+		table = read_bits_checked(input, index_bits);
+	}
+
+	std::vector<Tree::CodeLengths> code_lengths(tables_num);
+
+	for(Tree::CodeLengths& lengths : code_lengths) {
+		lengths.fill(0);
+
+		if(read_bits_checked(input, 1)) {
+			uint16_t character_count = read_bits_checked(input, CHARACTER_BITS) + 1;
+
+			for(uint16_t i = 0; i < character_count; i++) {
+				uint8_t character = read_bits_checked(input, CHARACTER_BITS);
+				lengths[character] = read_bits_checked(input, CODE_LENGTH_BITS);
+			}
+		} else {
+			for(uint8_t& length : lengths) {
+				length = read_bits_checked(input, CODE_LENGTH_BITS);
+			}
+		}
+	}
+
+	return ContextModel(context_map, code_lengths);
+}
+
+uint64_t Huffman::ContextModel::serialized_size(const std::vector<uint16_t>& character_counts) {
+	uint64_t result = TABLES_NUM_BITS + 256 * table_index_bits(character_counts.size());
+
+	for(uint16_t character_count : character_counts) {
+		result += 1 + (is_sparse(character_count) ? CHARACTER_BITS + character_count * (CHARACTER_BITS + CODE_LENGTH_BITS) : 256 * CODE_LENGTH_BITS);
+	}
+
+	return result;
+}
+
+Huffman::ContextModel::InvalidContextsException::InvalidContextsException() {
+	m_Message = "The context tables are invalid.";
+}
+
+const char* Huffman::ContextModel::InvalidContextsException::what() const noexcept {
+	return m_Message.c_str();
+}
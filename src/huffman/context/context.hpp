@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../buffer/buffer.hpp"
+#include "../decoder/decoder.hpp"
+#include "../span/span.hpp"
+#include "../tree/tree.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Huffman {
+	/// @brief Order-1 codes: every character is encoded with the table picked by the character before it
+	/// Previous characters with similar statistics share a table, so that the few tables can be stored with every block
+	/// The first character of a block is encoded as if it followed the character 0
+	/// The tables for encoding and decoding are built once when the model is created
+	class ContextModel {
+	public:
+		/// @brief The index of the table of every previous character
+		using ContextMap = std::array<uint8_t, 256>;
+
+		static constexpr size_t MAX_TABLES = 16;
+		/// @brief Every code of every table is resolved with a single lookup of a small table
+		static constexpr uint8_t MAX_CODE_LENGTH = DecodeTable::LOOKUP_BITS;
+
+	private:
+		ContextMap m_ContextMap;
+		std::vector<Tree::CodeLengths> m_CodeLengths;
+		std::vector<Tree::CodeTable> m_CodeTables;
+		std::vector<DecodeTable> m_DecodeTables;
+
+	public:
+		/// @param context_map The index of the table of every previous character, characters which never come first may take any table
+		/// @param code_lengths Lengths of a complete prefix code for every table, none longer than `MAX_CODE_LENGTH`
+		ContextModel(const ContextMap& context_map, const std::vector<Tree::CodeLengths>& code_lengths);
+
+		const ContextMap& get_context_map() const;
+		const std::vector<Tree::CodeLengths>& get_code_lengths() const;
+
+		/// @brief Encodes the block, which may only hold characters having a code in the table of the character before them
+		/// @param encoded_size How many bits the block is expected to take, to reserve the output
+		Buffer encode(ByteSpan block, uint64_t encoded_size) const;
+
+		/// @brief Decodes a message into the output, switching tables after every character
+		/// @param length How many bits of the input the message takes
+		/// @param output Exactly as large as the decoded message
+		/// @return False if the message doesn't decode to exactly the output
+		bool decode(ByteSpan input, uint64_t length, MutableByteSpan output) const;
+
+		/// @brief Serializes the context map and the code lengths of every table
+		Buffer serialize() const;
+
+		/// @brief Deserializes a model serialized using the `serialize` method
+		static ContextModel deserialize(const Buffer& buffer);
+
+		/// @brief How many bits a model serializes into, given how many characters have codes in each of its tables
+		static uint64_t serialized_size(const std::vector<uint16_t>& character_counts);
+
+	public:
+		class InvalidContextsException : public std::exception {
+			std::string m_Message;
+
+		public:
+			InvalidContextsException();
+
+			const char* what() const noexcept override;
+		};
+	};
+};
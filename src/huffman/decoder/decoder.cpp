@@ -0,0 +1,386 @@
+#include "decoder.hpp"
+
+#include <algorithm>
+#include <vector>
+
+Huffman::DecodeTable::DecodeTable(const Tree& tree) {
+	// Flatten the tree by inserting every code into a binary trie
+	m_Nodes.push_back({ 0, 0 });
+
+	uint8_t longest_code = 0;
+
+	for(const auto& [character, code] : tree.get_codes()) {
+		uint16_t node = 0;
+		longest_code = std::max<uint64_t>(longest_code, code.get_length());
+
+		for(auto it = code.bit_begin(); it != code.bit_end();) {
+			bool bit = *it;
+			++it;
+
+			if(it == code.bit_end()) {
+				m_Nodes[node][bit] = LEAF_FLAG | character;
+				break;
+			}
+
+			if(m_Nodes[node][bit] == 0) {
+				m_Nodes[node][bit] = m_Nodes.size();
+				m_Nodes.push_back({ 0, 0 });
+			}
+
+			node = m_Nodes[node][bit];
+		}
+	}
+
+	fill_entries(longest_code);
+}
+
+Huffman::DecodeTable::DecodeTable(const Tree::CodeLengths& code_lengths) {
+	m_Nodes.push_back({ 0, 0 });
+
+	Tree::CanonicalCodes codes = Tree::canonical_codes(code_lengths);
+
+	for(uint16_t character = 0; character < code_lengths.size(); character++) {
+		if(code_lengths[character] > 0) {
+			insert_code(character, codes[character], code_lengths[character]);
+		}
+	}
+
+	fill_entries(*std::max_element(code_lengths.begin(), code_lengths.end()));
+}
+
+uint8_t Huffman::DecodeTable::get_lookup_bits() const {
+	return m_LookupBits;
+}
+
+void Huffman::DecodeTable::insert_code(uint8_t character, uint64_t code, uint8_t length) {
+	uint16_t node = 0;
+
+	for(uint8_t bit_index = length - 1; bit_index > 0; bit_index--) {
+		bool bit = (code >> bit_index) & 1;
+
+		if(m_Nodes[node][bit] == 0) {
+			m_Nodes[node][bit] = m_Nodes.size();
+			m_Nodes.push_back({ 0, 0 });
+		}
+
+		node = m_Nodes[node][bit];
+	}
+
+	m_Nodes[node][code & 1] = LEAF_FLAG | character;
+}
+
+void Huffman::DecodeTable::fill_entries(uint8_t longest_code) {
+	// A table as wide as the longest code resolves every code at once, narrower ones fall back to the slow path
+	m_LookupBits = longest_code <= MAX_LOOKUP_BITS ? std::max<uint8_t>(longest_code, 1) : LOOKUP_BITS;
+	m_MaxStepBits = std::max(m_LookupBits, longest_code);
+	m_Entries.resize(size_t(1) << m_LookupBits);
+
+	for(uint32_t index = 0; index < m_Entries.size(); index++) {
+		fill_entry(index);
+	}
+}
+
+void Huffman::DecodeTable::fill_entry(uint32_t index) {
+	Entry& entry = m_Entries[index];
+	entry = { 0, { 0 }, 0, 0, 0 };
+
+	uint16_t node = 0;
+	uint8_t bits_used = 0;
+
+	for(uint8_t bit_index = 0; bit_index < m_LookupBits; bit_index++) {
+		bool bit = (index >> (m_LookupBits - 1 - bit_index)) & 1;
+		uint16_t child = m_Nodes[node][bit];
+
+		if(child & LEAF_FLAG) {
+			entry.symbols[entry.symbol_count++] = static_cast<uint8_t>(child);
+			bits_used = bit_index + 1;
+			node = 0;
+
+			if(entry.symbol_count == 1) {
+				entry.first_length = bits_used;
+			}
+
+			if(entry.symbol_count == MAX_SYMBOLS_PER_ENTRY) {
+				break;
+			}
+		} else {
+			node = child;
+		}
+	}
+
+	if(entry.symbol_count == 0) {
+		// The code is longer than the lookup, continue from the reached node
+		entry.node = node;
+		entry.length = m_LookupBits;
+	} else {
+		entry.length = bits_used;
+	}
+}
+
+bool Huffman::DecodeTable::decode_slow(BitReader& input, uint16_t node, uint8_t& symbol) const {
+	while(input.get_remaining() > 0) {
+		uint16_t child = m_Nodes[node][input.read_bit()];
+
+		if(child & LEAF_FLAG) {
+			symbol = static_cast<uint8_t>(child);
+			return true;
+		}
+
+		node = child;
+	}
+
+	return false;
+}
+
+bool Huffman::DecodeTable::decode_symbol_slow(BitReader& input, uint8_t& symbol) const {
+	const Entry& entry = m_Entries[input.peek(m_LookupBits)];
+
+	if(entry.symbol_count == 0 && input.get_remaining() >= m_LookupBits) {
+		input.consume(m_LookupBits);
+
+		return decode_slow(input, entry.node, symbol);
+	}
+
+	// Close to the end the code is resolved bit by bit
+	return decode_slow(input, 0, symbol);
+}
+
+inline uint8_t Huffman::DecodeTable::decode_step(BitReader& input, char* output) const {
+	const Entry& entry = m_Entries[input.peek(m_LookupBits)];
+	input.consume(entry.length);
+
+	if(entry.symbol_count > 0) {
+		for(uint8_t i = 0; i < MAX_SYMBOLS_PER_ENTRY; i++) {
+			output[i] = static_cast<char>(entry.symbols[i]);
+		}
+
+		return entry.symbol_count;
+	}
+
+	uint8_t symbol;
+
+	if(!decode_slow(input, entry.node, symbol)) {
+		return 0;
+	}
+
+	output[0] = static_cast<char>(symbol);
+
+	return 1;
+}
+
+template <typename Write>
+void Huffman::DecodeTable::decode_chunks(const Buffer& input, Write write) const {
+	BitReader reader(input);
+
+	// Symbols are gathered in a fixed chunk and written out all at once
+	const size_t chunk_size = 1 << 16;
+	std::vector<char> chunk(chunk_size);
+	size_t chunk_used = 0;
+
+	const uint8_t lookup_bits = m_LookupBits;
+
+	while(reader.get_remaining() >= lookup_bits) {
+		uint8_t decoded = decode_step(reader, chunk.data() + chunk_used);
+
+		if(decoded == 0) {
+			break;
+		}
+
+		chunk_used += decoded;
+
+		if(chunk_used + MAX_SYMBOLS_PER_ENTRY > chunk_size) {
+			write(chunk.data(), chunk_used);
+			chunk_used = 0;
+		}
+	}
+
+	// The last few bits are too short for a full lookup
+	uint8_t symbol;
+
+	while(reader.get_remaining() > 0 && decode_slow(reader, 0, symbol)) {
+		chunk[chunk_used++] = static_cast<char>(symbol);
+
+		if(chunk_used == chunk_size) {
+			write(chunk.data(), chunk_used);
+			chunk_used = 0;
+		}
+	}
+
+	write(chunk.data(), chunk_used);
+}
+
+void Huffman::DecodeTable::decode(const Buffer& input, std::ostream& output) const {
+	decode_chunks(input, [&output](const char* chunk, size_t size) {
+		output.write(chunk, size);
+	});
+}
+
+void Huffman::DecodeTable::decode(const Buffer& input, std::string& output) const {
+	decode_chunks(input, [&output](const char* chunk, size_t size) {
+		output.append(chunk, size);
+	});
+}
+
+inline void Huffman::DecodeTable::decode_step(BitReader& reader, char*& output, const Entry* entries, uint8_t lookup_bits) const {
+	const Entry& entry = entries[reader.peek(lookup_bits)];
+	reader.consume(entry.length);
+
+	for(uint8_t i = 0; i < MAX_SYMBOLS_PER_ENTRY; i++) {
+		output[i] = static_cast<char>(entry.symbols[i]);
+	}
+
+	output += entry.symbol_count;
+
+	if(entry.symbol_count > 0) {
+		return;
+	}
+
+	// Long codes are resolved on a copy, as passing the reader itself out of the loop would keep it out of the registers
+	BitReader long_code_reader = reader;
+	uint8_t symbol;
+
+	if(decode_slow(long_code_reader, entry.node, symbol)) {
+		*output++ = static_cast<char>(symbol);
+	}
+
+	reader = long_code_reader;
+}
+
+void Huffman::DecodeTable::decode_four_streams(std::vector<BitReader>& readers, std::vector<uint64_t>& positions, const std::vector<uint64_t>& ends, char* symbols) const {
+	// The symbols are written through a char pointer, which the compiler assumes could point at anything it can't see all uses of
+	// Everything the loop touches is copied into locals for that reason, so that the four lookups of a round can overlap
+	BitReader first = readers[0];
+	BitReader second = readers[1];
+	BitReader third = readers[2];
+	BitReader fourth = readers[3];
+
+	char* first_output = symbols + positions[0];
+	char* second_output = symbols + positions[1];
+	char* third_output = symbols + positions[2];
+	char* fourth_output = symbols + positions[3];
+
+	const char* first_end = symbols + ends[0];
+	const char* second_end = symbols + ends[1];
+	const char* third_end = symbols + ends[2];
+	const char* fourth_end = symbols + ends[3];
+
+	const Entry* entries = m_Entries.data();
+	const uint8_t lookup_bits = m_LookupBits;
+	const uint8_t max_step_bits = m_MaxStepBits;
+
+	while(true) {
+		uint64_t rounds = std::min({
+			first.get_remaining() / max_step_bits, second.get_remaining() / max_step_bits,
+			third.get_remaining() / max_step_bits, fourth.get_remaining() / max_step_bits,
+			static_cast<uint64_t>(first_end - first_output) / MAX_SYMBOLS_PER_ENTRY,
+			static_cast<uint64_t>(second_end - second_output) / MAX_SYMBOLS_PER_ENTRY,
+			static_cast<uint64_t>(third_end - third_output) / MAX_SYMBOLS_PER_ENTRY,
+			static_cast<uint64_t>(fourth_end - fourth_output) / MAX_SYMBOLS_PER_ENTRY
+		});
+
+		if(rounds == 0) {
+			break;
+		}
+
+		for(; rounds > 0; rounds--) {
+			decode_step(first, first_output, entries, lookup_bits);
+			decode_step(second, second_output, entries, lookup_bits);
+			decode_step(third, third_output, entries, lookup_bits);
+			decode_step(fourth, fourth_output, entries, lookup_bits);
+		}
+	}
+
+	readers[0] = first;
+	readers[1] = second;
+	readers[2] = third;
+	readers[3] = fourth;
+
+	positions[0] = first_output - symbols;
+	positions[1] = second_output - symbols;
+	positions[2] = third_output - symbols;
+	positions[3] = fourth_output - symbols;
+}
+
+bool Huffman::DecodeTable::decode_streams(ByteSpan input, const std::vector<uint64_t>& stream_lengths, MutableByteSpan output) const {
+	size_t streams_num = stream_lengths.size();
+	uint64_t length = output.size();
+
+	if(streams_num == 0) {
+		return length == 0;
+	}
+
+	uint64_t segment_size = length / streams_num + (length % streams_num > 0);
+	char* symbols = reinterpret_cast<char*>(output.data());
+
+	// Every stream starts at a byte boundary right after the previous one
+	std::vector<BitReader> readers;
+	std::vector<uint64_t> positions(streams_num);
+	std::vector<uint64_t> ends(streams_num);
+
+	readers.reserve(streams_num);
+	uint64_t byte_offset = 0;
+
+	for(size_t i = 0; i < streams_num; i++) {
+		if(stream_lengths[i] > (input.size() - byte_offset) * 8) {
+			return false;
+		}
+
+		readers.emplace_back(input.data() + byte_offset, stream_lengths[i]);
+		byte_offset += stream_lengths[i] / 8 + (stream_lengths[i] % 8 > 0);
+
+		positions[i] = std::min(length, i * segment_size);
+		ends[i] = std::min(length, (i + 1) * segment_size);
+	}
+
+	// A round advances every stream by one lookup, which takes at most `m_MaxStepBits` bits and writes at most `MAX_SYMBOLS_PER_ENTRY` symbols
+	// Rounds are run in batches which are known to fit every stream, so that the loop needs no checks
+	// Four streams get a loop of their own, which keeps every stream in registers
+	if(streams_num == 4) {
+		decode_four_streams(readers, positions, ends, symbols);
+	} else {
+		while(true) {
+			uint64_t rounds = UINT64_MAX;
+
+			for(size_t i = 0; i < streams_num; i++) {
+				rounds = std::min(rounds, readers[i].get_remaining() / m_MaxStepBits);
+				rounds = std::min(rounds, (ends[i] - positions[i]) / MAX_SYMBOLS_PER_ENTRY);
+			}
+
+			if(rounds == 0) {
+				break;
+			}
+
+			for(; rounds > 0; rounds--) {
+				for(size_t i = 0; i < streams_num; i++) {
+					positions[i] += decode_step(readers[i], symbols + positions[i]);
+				}
+			}
+		}
+	}
+
+	// Finish every stream on its own, close to the end of the bits or the segment
+	for(size_t i = 0; i < streams_num; i++) {
+		BitReader& reader = readers[i];
+
+		while(positions[i] < ends[i]) {
+			if(reader.get_remaining() >= m_MaxStepBits && ends[i] - positions[i] >= MAX_SYMBOLS_PER_ENTRY) {
+				positions[i] += decode_step(reader, symbols + positions[i]);
+				continue;
+			}
+
+			uint8_t symbol;
+
+			if(reader.get_remaining() == 0 || !decode_slow(reader, 0, symbol)) {
+				return false;
+			}
+
+			symbols[positions[i]++] = static_cast<char>(symbol);
+		}
+
+		if(reader.get_remaining() > 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
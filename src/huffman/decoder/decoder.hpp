@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../bitstream/bitstream.hpp"
+#include "../buffer/buffer.hpp"
+#include "../span/span.hpp"
+#include "../tree/tree.hpp"
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Huffman {
+	/// @brief A decoder looking up multiple bits of the encoded message at once in a precomputed table
+	class DecodeTable {
+	public:
+		/// @brief How many bits are resolved by a single table lookup, unless all codes fit in a table of at most `MAX_LOOKUP_BITS`
+		static constexpr uint8_t LOOKUP_BITS = 11;
+		/// @brief The widest table built to resolve every code with a single lookup, as length-limited codes allow
+		static constexpr uint8_t MAX_LOOKUP_BITS = 16;
+		/// @brief How many symbols a single table entry can emit at most
+		static constexpr uint8_t MAX_SYMBOLS_PER_ENTRY = 3;
+
+	private:
+		struct Entry {
+			/// @brief For codes longer than the lookup the tree node reached after it
+			uint16_t node;
+			uint8_t symbols[MAX_SYMBOLS_PER_ENTRY];
+			/// @brief Zero if the code is longer than the lookup and has to be resolved with the slow path
+			uint8_t symbol_count;
+			/// @brief How many bits the entry consumes
+			uint8_t length;
+			/// @brief How many bits the first symbol of the entry consumes
+			uint8_t first_length;
+		};
+
+		/// @brief The Huffman tree flattened into pairs of children, used to resolve long codes
+		/// Children with the `LEAF_FLAG` set are leaves, the lower byte storing their symbol
+		std::vector<std::array<uint16_t, 2>> m_Nodes;
+		std::vector<Entry> m_Entries;
+		/// @brief How many bits index the entries
+		uint8_t m_LookupBits;
+		/// @brief The most bits a single lookup with its slow path can consume
+		uint8_t m_MaxStepBits;
+
+		static constexpr uint16_t LEAF_FLAG = 0x8000;
+
+	public:
+		explicit DecodeTable(const Tree& tree);
+
+		/// @brief Builds the table straight from code lengths, assuming canonical codes
+		explicit DecodeTable(const Tree::CodeLengths& code_lengths);
+
+		/// @brief How many bits index the table
+		uint8_t get_lookup_bits() const;
+
+		/// @brief Decodes the message and writes the symbols into the output
+		/// @param input A buffer containing the encoded message
+		/// @param output The stream the decoded symbols are written to
+		void decode(const Buffer& input, std::ostream& output) const;
+
+		/// @brief Decodes the message and appends the symbols to the output
+		void decode(const Buffer& input, std::string& output) const;
+
+		/// @brief Decodes a message split into consecutive segments encoded as separate streams, advancing all streams in one loop
+		/// Lookups in different streams don't depend on each other, so the CPU can overlap them
+		/// A message which isn't split is decoded as a single stream
+		/// @param input The streams one after another, each starting at a byte boundary
+		/// @param stream_lengths The length of every stream in bits
+		/// @param output Exactly as large as the decoded message, every segment but the last ones holding `ceil(size / streams)` symbols
+		/// @return False if the streams don't decode to exactly their segments
+		bool decode_streams(ByteSpan input, const std::vector<uint64_t>& stream_lengths, MutableByteSpan output) const;
+
+		/// @brief Decodes a single symbol, for messages switching between tables from one symbol to the next
+		/// @return False if the message ended in the middle of a code
+		bool decode_symbol(BitReader& input, uint8_t& symbol) const {
+			const Entry& entry = m_Entries[input.peek(m_LookupBits)];
+
+			if(entry.symbol_count > 0 && entry.first_length <= input.get_remaining()) {
+				input.consume(entry.first_length);
+				symbol = entry.symbols[0];
+
+				return true;
+			}
+
+			return decode_symbol_slow(input, symbol);
+		}
+
+	private:
+		// Helper functions for the constructors
+		void insert_code(uint8_t character, uint64_t code, uint8_t length);
+		// Sizes the table for the longest code and fills it
+		void fill_entries(uint8_t longest_code);
+		void fill_entry(uint32_t index);
+
+		// Decodes the symbols of a single table lookup, writing up to `MAX_SYMBOLS_PER_ENTRY` of them
+		// Returns how many of them are valid, zero if the message ended in the middle of a code
+		uint8_t decode_step(BitReader& input, char* output) const;
+
+		// Resolves a code bit by bit, starting from the given node
+		// Returns false if the message ended in the middle of the code
+		bool decode_slow(BitReader& input, uint16_t node, uint8_t& symbol) const;
+
+		// Decodes a single symbol whose code is longer than the lookup or runs into the end of the message
+		bool decode_symbol_slow(BitReader& input, uint8_t& symbol) const;
+
+		// Like the other `decode_step`, for a reader and an output kept in locals of the caller, advancing the output past the symbols
+		// Always writes `MAX_SYMBOLS_PER_ENTRY` symbols
+		void decode_step(BitReader& reader, char*& output, const Entry* entries, uint8_t lookup_bits) const;
+
+		// Advances four streams by one lookup each per round, in batches of rounds known to fit every stream
+		// The ends of the streams are left to the caller
+		void decode_four_streams(std::vector<BitReader>& readers, std::vector<uint64_t>& positions, const std::vector<uint64_t>& ends, char* symbols) const;
+
+		// Decodes the message, passing the symbols to `write` in chunks
+		template <typename Write>
+		void decode_chunks(const Buffer& input, Write write) const;
+	};
+};
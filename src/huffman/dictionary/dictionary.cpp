@@ -0,0 +1,129 @@
+#include "dictionary.hpp"
+
+#include <cstdio>
+
+namespace {
+	// Dictionary files start with their own header, so they're never mistaken for messages
+	const char DICTIONARY_HEADER[] = "HFD";
+	const uint8_t DICTIONARY_VERSION = 0;
+	const size_t DICTIONARY_SIZE = 3 + 1 + 4 + 256;
+
+	// FNV-1a over the code lengths
+	uint32_t compute_id(const Huffman::Tree::CodeLengths& code_lengths) {
+		uint32_t result = 2166136261u;
+
+		for(uint8_t length : code_lengths) {
+			result = (result ^ length) * 16777619u;
+		}
+
+		return result;
+	}
+
+	// Every character needs a code, as the messages encoded with the dictionary can hold anything
+	const Huffman::Tree::CodeLengths& validate(const Huffman::Tree::CodeLengths& code_lengths) {
+		for(uint8_t length : code_lengths) {
+			if(length == 0 || length > Huffman::Dictionary::MAX_CODE_LENGTH) {
+				throw Huffman::Dictionary::InvalidDictionaryException();
+			}
+		}
+
+		return code_lengths;
+	}
+
+	Huffman::Tree tree_from_code_lengths(const Huffman::Tree::CodeLengths& code_lengths) {
+		try {
+			return Huffman::Tree::from_code_lengths(validate(code_lengths));
+		} catch(const Huffman::Tree::DeserializationException&) {
+			throw Huffman::Dictionary::InvalidDictionaryException();
+		}
+	}
+}
+
+Huffman::Dictionary::Dictionary(const Tree::CodeLengths& code_lengths)
+	: m_Id(compute_id(code_lengths)), m_CodeLengths(code_lengths), m_Tree(tree_from_code_lengths(code_lengths)),
+	m_CodeTable(m_Tree.get_code_table()), m_DecodeTable(std::make_shared<const DecodeTable>(code_lengths)) {}
+
+uint32_t Huffman::Dictionary::get_id() const {
+	return m_Id;
+}
+
+const Huffman::Tree::CodeLengths& Huffman::Dictionary::get_code_lengths() const {
+	return m_CodeLengths;
+}
+
+const Huffman::Tree& Huffman::Dictionary::get_tree() const {
+	return m_Tree;
+}
+
+const Huffman::Tree::CodeTable& Huffman::Dictionary::get_code_table() const {
+	return m_CodeTable;
+}
+
+std::shared_ptr<const Huffman::DecodeTable> Huffman::Dictionary::get_decode_table() const {
+	return m_DecodeTable;
+}
+
+void Huffman::Dictionary::serialize(std::ostream& output) const {
+	char bytes[DICTIONARY_SIZE];
+
+	bytes[0] = DICTIONARY_HEADER[0];
+	bytes[1] = DICTIONARY_HEADER[1];
+	bytes[2] = DICTIONARY_HEADER[2];
+	bytes[3] = static_cast<char>(DICTIONARY_VERSION);
+
+	for(uint8_t i = 0; i < 4; i++) {
+		bytes[4 + i] = static_cast<char>(m_Id >> (8 * i));
+	}
+
+	for(uint16_t i = 0; i < m_CodeLengths.size(); i++) {
+		bytes[8 + i] = static_cast<char>(m_CodeLengths[i]);
+	}
+
+	output.write(bytes, DICTIONARY_SIZE);
+}
+
+Huffman::Dictionary Huffman::Dictionary::deserialize(ByteSpan input) {
+	auto byte = [&input](size_t index) {
+		return std::to_integer<uint8_t>(input[index]);
+	};
+
+	if(input.size() != DICTIONARY_SIZE || byte(0) != DICTIONARY_HEADER[0] || byte(1) != DICTIONARY_HEADER[1] || byte(2) != DICTIONARY_HEADER[2] || byte(3) != DICTIONARY_VERSION) {
+		throw InvalidDictionaryException();
+	}
+
+	uint32_t id = 0;
+
+	for(uint8_t i = 0; i < 4; i++) {
+		id |= static_cast<uint32_t>(byte(4 + i)) << (8 * i);
+	}
+
+	Tree::CodeLengths code_lengths;
+
+	for(uint16_t i = 0; i < code_lengths.size(); i++) {
+		code_lengths[i] = byte(8 + i);
+	}
+
+	Dictionary result(code_lengths);
+
+	// The stored ID guards against files damaged in a way which still leaves valid code lengths
+	if(result.get_id() != id) {
+		throw InvalidDictionaryException();
+	}
+
+	return result;
+}
+
+std::string Huffman::Dictionary::format_id(uint32_t id) {
+	char result[9];
+	std::snprintf(result, sizeof(result), "%08x", id);
+
+	return result;
+}
+
+Huffman::Dictionary::InvalidDictionaryException::InvalidDictionaryException() {
+	m_Message = "The dictionary is invalid.";
+}
+
+const char* Huffman::Dictionary::InvalidDictionaryException::what() const noexcept {
+	return m_Message.c_str();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../decoder/decoder.hpp"
+#include "../span/span.hpp"
+#include "../tree/tree.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace Huffman {
+	/// @brief Canonical codes shared by many messages, so that they don't have to store a tree of their own
+	/// Messages refer to the dictionary by its ID, the tables for encoding and decoding are built once when it's created
+	class Dictionary {
+		uint32_t m_Id;
+		Tree::CodeLengths m_CodeLengths;
+		Tree m_Tree;
+		Tree::CodeTable m_CodeTable;
+		std::shared_ptr<const DecodeTable> m_DecodeTable;
+
+	public:
+		/// @brief Every code fits a single-lookup decode table
+		static constexpr uint8_t MAX_CODE_LENGTH = DecodeTable::MAX_LOOKUP_BITS;
+
+		/// @param code_lengths Lengths of a complete prefix code covering every character, none longer than `MAX_CODE_LENGTH`
+		explicit Dictionary(const Tree::CodeLengths& code_lengths);
+
+		/// @brief The ID is derived from the code lengths, so equal dictionaries always have equal IDs
+		uint32_t get_id() const;
+		const Tree::CodeLengths& get_code_lengths() const;
+		const Tree& get_tree() const;
+		const Tree::CodeTable& get_code_table() const;
+		std::shared_ptr<const DecodeTable> get_decode_table() const;
+
+		/// @brief Serializes the dictionary into a dictionary file
+		void serialize(std::ostream& output) const;
+
+		/// @brief Deserializes a dictionary serialized using the `serialize` method
+		static Dictionary deserialize(ByteSpan input);
+
+		/// @brief Formats an ID the way it's shown to the user
+		static std::string format_id(uint32_t id);
+
+	public:
+		class InvalidDictionaryException : public std::exception {
+			std::string m_Message;
+
+		public:
+			InvalidDictionaryException();
+
+			const char* what() const noexcept override;
+		};
+	};
+};
@@ -0,0 +1,103 @@
+#include "file.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HFF_FILE_MMAP
+#endif
+
+Huffman::MappedFile::MappedFile(const std::string& filename)
+	: m_Mapping(nullptr), m_MappingSize(0), m_Open(false) {
+#ifdef HFF_FILE_MMAP
+	int descriptor = open(filename.c_str(), O_RDONLY);
+
+	if(descriptor < 0) {
+		return;
+	}
+
+	struct stat status;
+
+	// Only regular files have a size to map, empty ones can't be mapped but need no mapping either
+	if(fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+		if(status.st_size == 0) {
+			close(descriptor);
+			m_Open = true;
+
+			return;
+		}
+
+		void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+		if(mapping != MAP_FAILED) {
+			m_Mapping = mapping;
+			m_MappingSize = status.st_size;
+			m_Bytes = ByteSpan(static_cast<const std::byte*>(mapping), m_MappingSize);
+			m_Open = true;
+
+			// The file is read front to back, so the kernel can read ahead aggressively
+			madvise(m_Mapping, m_MappingSize, MADV_SEQUENTIAL);
+		}
+	}
+
+	close(descriptor);
+
+	if(m_Open) {
+		return;
+	}
+#endif
+
+	m_Open = read_content(filename);
+}
+
+Huffman::MappedFile::MappedFile(std::istream& input)
+	: m_Mapping(nullptr), m_MappingSize(0), m_Open(false) {
+	m_Open = read_content(input);
+}
+
+Huffman::MappedFile::~MappedFile() {
+#ifdef HFF_FILE_MMAP
+	if(m_Mapping != nullptr) {
+		munmap(m_Mapping, m_MappingSize);
+	}
+#endif
+}
+
+bool Huffman::MappedFile::is_open() const {
+	return m_Open;
+}
+
+Huffman::ByteSpan Huffman::MappedFile::get_bytes() const {
+	return m_Bytes;
+}
+
+bool Huffman::MappedFile::read_content(const std::string& filename) {
+	std::ifstream input(filename, std::ios::binary | std::ios::in);
+
+	if(!input.good()) {
+		return false;
+	}
+
+	return read_content(input);
+}
+
+bool Huffman::MappedFile::read_content(std::istream& input) {
+	// Read in large chunks, as the size of the file may not be known up front
+	const size_t chunk_size = 1 << 20;
+
+	while(input) {
+		size_t size = m_Content.size();
+		m_Content.resize(size + chunk_size);
+
+		input.read(reinterpret_cast<char*>(m_Content.data() + size), chunk_size);
+		m_Content.resize(size + input.gcount());
+	}
+
+	m_Bytes = ByteSpan(m_Content.data(), m_Content.size());
+
+	return !input.bad();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../span/span.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace Huffman {
+	/// @brief A whole file mapped into memory for reading, so that it's read without system calls or copies
+	/// Where mapping isn't supported, or the file can't be mapped (like a pipe), it's read into memory at once instead
+	class MappedFile {
+		/// @brief The mapped address, null if the file isn't mapped
+		void* m_Mapping;
+		size_t m_MappingSize;
+		/// @brief The content of files which couldn't be mapped
+		std::vector<std::byte> m_Content;
+		ByteSpan m_Bytes;
+		bool m_Open;
+
+	public:
+		/// @brief Opens and maps the file, `is_open` tells whether it succeeded
+		explicit MappedFile(const std::string& filename);
+		/// @brief Reads the whole stream into memory, for inputs which aren't files like the standard input
+		explicit MappedFile(std::istream& input);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool is_open() const;
+
+		/// @brief The content of the file, valid as long as the file is
+		ByteSpan get_bytes() const;
+
+	private:
+		// Reads the file the usual way, when it can't be mapped
+		bool read_content(const std::string& filename);
+		bool read_content(std::istream& input);
+	};
+};
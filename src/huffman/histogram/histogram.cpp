@@ -0,0 +1,83 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Consecutive bytes are counted in separate tables, so that runs of equal bytes
+	// Don't make every increment wait for the previous store to the same counter
+	const size_t TABLES_NUM = 8;
+
+	// 32-bit counters keep the tables in the L1 cache, they're added up before they can overflow
+	using SubTables = std::array<std::array<uint32_t, 256>, TABLES_NUM>;
+	const size_t MAX_CHUNK_SIZE = size_t(1) << 31;
+
+	void add_tables(Huffman::Histogram& result, const SubTables& tables) {
+		for(const auto& table : tables) {
+			for(uint16_t i = 0; i < 256; i++) {
+				result[i] += table[i];
+			}
+		}
+	}
+
+	// Counts the bytes of an eight byte word, one table per byte
+	inline void count_word(SubTables& tables, uint64_t word) {
+		for(uint8_t i = 0; i < TABLES_NUM; i++) {
+			tables[i][static_cast<uint8_t>(word >> (8 * i))]++;
+		}
+	}
+
+	void count_chunk(Huffman::Histogram& result, const std::byte* data, size_t size) {
+		SubTables tables = {};
+
+		size_t i = 0;
+
+		for(; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+
+			count_word(tables, word);
+		}
+
+		for(; i < size; i++) {
+			tables[0][std::to_integer<uint8_t>(data[i])]++;
+		}
+
+		add_tables(result, tables);
+	}
+}
+
+Huffman::Histogram Huffman::histogram(const std::byte* data, size_t size) {
+	Histogram result;
+	result.fill(0);
+
+	for(size_t offset = 0; offset < size; offset += MAX_CHUNK_SIZE) {
+		count_chunk(result, data + offset, std::min(MAX_CHUNK_SIZE, size - offset));
+	}
+
+	return result;
+}
+
+double Huffman::entropy(const Histogram& histogram) {
+	uint64_t total = 0;
+
+	for(uint64_t count : histogram) {
+		total += count;
+	}
+
+	if(total == 0) {
+		return 0;
+	}
+
+	double result = 0;
+
+	for(uint64_t count : histogram) {
+		if(count > 0) {
+			double probability = static_cast<double>(count) / total;
+			result -= probability * std::log2(probability);
+		}
+	}
+
+	return result;
+}
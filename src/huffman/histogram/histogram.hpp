@@ -0,0 +1,17 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Huffman {
+	/// @brief How many times every byte value occurs
+	using Histogram = std::array<uint64_t, 256>;
+
+	/// @brief Counts the occurances of every byte value
+	Histogram histogram(const std::byte* data, size_t size);
+
+	/// @brief Estimates the entropy of data with the given histogram
+	/// @return The average number of bits per symbol an ideal order-0 coder would need
+	double entropy(const Histogram& histogram);
+}
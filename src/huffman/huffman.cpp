@@ -1,108 +1,1713 @@
 #include "huffman.hpp"
 
+#include "bitstream/bitstream.hpp"
+#include "checksum/checksum.hpp"
+#include "container/container.hpp"
+#include "context/context.hpp"
+#include "decoder/decoder.hpp"
+#include "pool/pool.hpp"
+#include "profile/profile.hpp"
 #include "tree/tree.hpp"
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
 #include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <utility>
-#include <queue>
 #include <vector>
 
-Huffman::EncodedMessage Huffman::encode(std::istream& input) {
-	// Count occurances (probablities) of the characters in the text
-	std::array<uint64_t, 255> occurances;
-	std::fill(occurances.begin(), occurances.end(), 0);
+namespace {
+	using Huffman::Histogram;
 
-	std::string message = "";
+	// Builds the Huffman tree for the given character occurances in linear time after a single sort
+	// Uses the two-queue method: the leaves sorted by occurances form one queue and the parents form the other
+	// Parents are created in non-decreasing order of occurances, so the least probable subtree is always at the front of one of them
+	Huffman::Tree build_tree(const Histogram& occurances) {
+		Huffman::Tree result;
 
-	input >> std::noskipws;
+		struct Subtree {
+			uint64_t occurances;
+			uint16_t node;
+		};
 
-	uint8_t current_character, prev_character = '\0';
-	bool multiple_chars = false;
-	while(input >> current_character) {
-		occurances[current_character - 1]++;
-		message += current_character;
+		std::array<Subtree, 256> leaves;
+		uint16_t leaves_num = 0;
 
-		if(prev_character != '\0' && prev_character != current_character) {
-			multiple_chars = true;
+		uint8_t last_character = 0;
+
+		for(uint16_t i = 0; i < occurances.size(); i++) {
+			if(occurances[i] > 0) {
+				leaves[leaves_num++] = { occurances[i], result.add_leaf(i, occurances[i]) };
+				last_character = i;
+			}
+		}
+
+		// A tree needs at least two leaves to give a character a code
+		// The added character never occurs, so its code goes unused
+		if(leaves_num < 2) {
+			leaves[leaves_num++] = { 0, result.add_leaf(last_character == 0 ? 1 : 0, 0) };
+		}
+
+		if(leaves_num < 2) {
+			leaves[leaves_num++] = { 0, result.add_leaf(last_character == 0 ? 2 : 1, 0) };
+		}
+
+		// Ties are broken by the node, which keeps the tree independent of the sorting algorithm
+		std::sort(leaves.begin(), leaves.begin() + leaves_num, [](const Subtree& left, const Subtree& right) {
+			return left.occurances < right.occurances || (left.occurances == right.occurances && left.node < right.node);
+		});
+
+		std::array<Subtree, 255> parents;
+		uint16_t parents_begin = 0;
+		uint16_t parents_end = 0;
+		uint16_t leaves_begin = 0;
+
+		// Takes the least probable subtree from the front of either queue, preferring leaves on ties
+		auto take_least = [&]() {
+			if(parents_begin == parents_end || (leaves_begin < leaves_num && leaves[leaves_begin].occurances <= parents[parents_begin].occurances)) {
+				return leaves[leaves_begin++];
+			}
+
+			return parents[parents_begin++];
+		};
+
+		// Fuse the subtrees, the last parent added becomes the root
+		for(uint16_t i = 1; i < leaves_num; i++) {
+			Subtree first = take_least();
+			Subtree second = take_least();
+
+			parents[parents_end++] = { first.occurances + second.occurances, result.add_parent(first.node, second.node) };
 		}
 
-		prev_character = current_character;
+		return result;
+	}
+
+	// Finds optimal code lengths no longer than `max_length` for the characters which have codes in `code_lengths`
+	// Uses the package-merge algorithm: every level lists the characters and the packages of pairs of items of the level below
+	// Sorted by occurances, the lightest 2n - 2 items of the last level then determine the lengths
+	Huffman::Tree::CodeLengths limit_code_lengths(const Histogram& occurances, const Huffman::Tree::CodeLengths& code_lengths, uint8_t max_length) {
+		std::array<uint8_t, 256> characters;
+		uint16_t characters_num = 0;
+
+		for(uint16_t i = 0; i < code_lengths.size(); i++) {
+			if(code_lengths[i] > 0) {
+				characters[characters_num++] = i;
+			}
+		}
+
+		std::sort(characters.begin(), characters.begin() + characters_num, [&occurances](uint8_t left, uint8_t right) {
+			return occurances[left] < occurances[right] || (occurances[left] == occurances[right] && left < right);
+		});
+
+		// Only which items are packages has to be remembered, the characters always come in the sorted order
+		std::vector<std::vector<bool>> is_package(max_length);
+		std::vector<uint64_t> previous_level(characters_num);
+
+		for(uint16_t i = 0; i < characters_num; i++) {
+			previous_level[i] = occurances[characters[i]];
+		}
+
+		is_package[0].assign(characters_num, false);
+
+		for(uint8_t level = 1; level < max_length; level++) {
+			std::vector<uint64_t> current_level;
+			current_level.reserve(characters_num + previous_level.size() / 2);
+
+			size_t character_index = 0;
+			size_t package_index = 0;
+			size_t packages_num = previous_level.size() / 2;
+
+			while(character_index < characters_num || package_index < packages_num) {
+				uint64_t package = package_index < packages_num
+					? previous_level[2 * package_index] + previous_level[2 * package_index + 1]
+					: 0;
+
+				if(package_index == packages_num || (character_index < characters_num && occurances[characters[character_index]] <= package)) {
+					current_level.push_back(occurances[characters[character_index++]]);
+					is_package[level].push_back(false);
+				} else {
+					current_level.push_back(package);
+					is_package[level].push_back(true);
+					package_index++;
+				}
+			}
+
+			previous_level = std::move(current_level);
+		}
+
+		// Every time a character is taken its code gets a bit longer, every package taken takes two items of the level below
+		Huffman::Tree::CodeLengths result;
+		result.fill(0);
+
+		size_t items_num = 2 * characters_num - 2;
+
+		for(uint8_t level = max_length; level-- > 0;) {
+			size_t packages_taken = 0;
+			size_t characters_taken = 0;
+
+			for(size_t i = 0; i < items_num; i++) {
+				if(is_package[level][i]) {
+					packages_taken++;
+				} else {
+					result[characters[characters_taken++]]++;
+				}
+			}
+
+			items_num = 2 * packages_taken;
+		}
+
+		return result;
+	}
+
+	// Builds codes for every character, the ones which didn't occur are counted as if they occurred once
+	// The codes are kept short enough for a single-lookup decode table
+	Huffman::Tree::CodeLengths complete_code_lengths(const Histogram& occurances) {
+		Histogram smoothed_occurances = occurances;
+
+		for(uint64_t& count : smoothed_occurances) {
+			count++;
+		}
+
+		Huffman::Tree::CodeLengths result = build_tree(smoothed_occurances).get_code_lengths();
+
+		if(*std::max_element(result.begin(), result.end()) > Huffman::DecodeTable::MAX_LOOKUP_BITS) {
+			result = limit_code_lengths(smoothed_occurances, result, Huffman::DecodeTable::MAX_LOOKUP_BITS);
+		}
+
+		return result;
+	}
+
+	// Canonical codes are fully described by their lengths
+	Huffman::DecodeTable make_table(const Huffman::Tree& huffman_tree, bool canonical) {
+		HFF_PROFILE_PHASE(Huffman::Phase::TableBuild);
+
+		return canonical ? Huffman::DecodeTable(huffman_tree.get_code_lengths()) : Huffman::DecodeTable(huffman_tree);
+	}
+
+	// Only blocks of hundreds of gigabytes can have codes this long
+	void ensure_code_lengths_supported(const Huffman::Tree::CodeLengths& code_lengths) {
+		if(*std::max_element(code_lengths.begin(), code_lengths.end()) > Huffman::Tree::MAX_CODE_LENGTH) {
+			throw Huffman::BlockTooLargeException();
+		}
+	}
+
+	// Everything about a block which can be worked out independently of the other blocks
+	struct BlockAnalysis {
+		Histogram occurances;
+		/// @brief Whether the block is a single character repeated, which is stored without a tree
+		bool run;
+		std::optional<Huffman::Tree> huffman_tree;
+		Huffman::Tree::CodeLengths code_lengths;
+		/// @brief How many bits it takes to store the tree in the block header
+		uint64_t tree_cost;
+		/// @brief How many more bits the block takes with the codes limited in length
+		uint64_t length_limit_cost;
+		/// @brief The order-1 tables the block is encoded with instead of a tree, if they're worth it
+		std::shared_ptr<const Huffman::ContextModel> contexts;
+		/// @brief How many bits the block takes encoded with the order-1 tables
+		uint64_t contexts_encoded_size;
+	};
+
+	// How many bits the characters take coded with the ideal code for their own occurances
+	double ideal_size(const Histogram& occurances) {
+		return Huffman::entropy(occurances) * std::accumulate(occurances.begin(), occurances.end(), uint64_t(0));
+	}
+
+	uint16_t coded_characters(const Histogram& occurances) {
+		uint16_t result = std::count_if(occurances.begin(), occurances.end(), [](uint64_t count) {
+			return count > 0;
+		});
+
+		// A table always has at least two codes
+		return std::max<uint16_t>(result, 2);
+	}
+
+	// The previous characters sharing an order-1 table, along with their occurances put together
+	struct ContextClusters {
+		Huffman::ContextModel::ContextMap context_map;
+		std::vector<Histogram> occurances;
+	};
+
+	// Estimates how many bits the block takes with the clusters, including the tables
+	double clusters_cost(const ContextClusters& clusters) {
+		std::vector<uint16_t> character_counts;
+		double result = 0;
+
+		for(const Histogram& occurances : clusters.occurances) {
+			result += ideal_size(occurances);
+			character_counts.push_back(coded_characters(occurances));
+		}
+
+		return result + Huffman::ContextModel::serialized_size(character_counts);
+	}
+
+	// Groups the previous characters of the block into at most `max_tables` clusters coded with the same table
+	// The most frequent contexts seed the clusters, which are refined by moving every context to the cluster coding it in the fewest bits
+	// Then the clusters are merged pair by pair, cheapest merge first, and the number of clusters estimated to take the fewest bits wins
+	ContextClusters cluster_contexts(const std::vector<Histogram>& context_occurances, size_t max_tables) {
+		std::vector<uint8_t> contexts;
+		std::vector<uint64_t> context_totals(context_occurances.size());
+
+		for(uint16_t i = 0; i < context_occurances.size(); i++) {
+			context_totals[i] = std::accumulate(context_occurances[i].begin(), context_occurances[i].end(), uint64_t(0));
+
+			if(context_totals[i] > 0) {
+				contexts.push_back(i);
+			}
+		}
+
+		std::stable_sort(contexts.begin(), contexts.end(), [&context_totals](uint8_t left, uint8_t right) {
+			return context_totals[left] > context_totals[right];
+		});
+
+		ContextClusters clusters;
+		clusters.context_map.fill(0);
+
+		for(size_t i = 0; i < std::min(max_tables, contexts.size()); i++) {
+			clusters.occurances.push_back(context_occurances[contexts[i]]);
+		}
+
+		const size_t refinement_rounds = 8;
+
+		for(size_t round = 0; round < refinement_rounds; round++) {
+			// Characters a cluster hasn't seen yet are counted as half an occurance
+			std::vector<std::array<double, 256>> code_lengths(clusters.occurances.size());
+
+			for(size_t i = 0; i < clusters.occurances.size(); i++) {
+				double total = std::accumulate(clusters.occurances[i].begin(), clusters.occurances[i].end(), 0.0) + 128;
+
+				for(uint16_t character = 0; character < 256; character++) {
+					code_lengths[i][character] = -std::log2((clusters.occurances[i][character] + 0.5) / total);
+				}
+			}
+
+			bool moved = false;
+
+			for(uint8_t context : contexts) {
+				double best_cost = INFINITY;
+				uint8_t best_cluster = 0;
+
+				for(size_t i = 0; i < code_lengths.size(); i++) {
+					double cost = 0;
+
+					for(uint16_t character = 0; character < 256; character++) {
+						cost += context_occurances[context][character] * code_lengths[i][character];
+					}
+
+					if(cost < best_cost) {
+						best_cost = cost;
+						best_cluster = i;
+					}
+				}
+
+				moved = moved || clusters.context_map[context] != best_cluster;
+				clusters.context_map[context] = best_cluster;
+			}
+
+			if(round > 0 && !moved) {
+				break;
+			}
+
+			// Clusters left without contexts are dropped
+			std::vector<Histogram> occurances(clusters.occurances.size(), Histogram{});
+			std::vector<uint8_t> renumbered(clusters.occurances.size(), 0);
+
+			for(uint8_t context : contexts) {
+				Histogram& cluster = occurances[clusters.context_map[context]];
+
+				for(uint16_t character = 0; character < 256; character++) {
+					cluster[character] += context_occurances[context][character];
+				}
+			}
+
+			clusters.occurances.clear();
+
+			for(size_t i = 0; i < occurances.size(); i++) {
+				if(std::any_of(occurances[i].begin(), occurances[i].end(), [](uint64_t count) { return count > 0; })) {
+					renumbered[i] = clusters.occurances.size();
+					clusters.occurances.push_back(occurances[i]);
+				}
+			}
+
+			for(uint8_t context : contexts) {
+				clusters.context_map[context] = renumbered[clusters.context_map[context]];
+			}
+		}
+
+		ContextClusters best = clusters;
+		double best_cost = clusters_cost(clusters);
+
+		while(clusters.occurances.size() > 1) {
+			size_t merged_left = 0;
+			size_t merged_right = 1;
+			double smallest_growth = INFINITY;
+
+			for(size_t left = 0; left < clusters.occurances.size(); left++) {
+				for(size_t right = left + 1; right < clusters.occurances.size(); right++) {
+					Histogram merged = clusters.occurances[left];
+
+					for(uint16_t character = 0; character < 256; character++) {
+						merged[character] += clusters.occurances[right][character];
+					}
+
+					double growth = ideal_size(merged) - ideal_size(clusters.occurances[left]) - ideal_size(clusters.occurances[right]);
+
+					if(growth < smallest_growth) {
+						smallest_growth = growth;
+						merged_left = left;
+						merged_right = right;
+					}
+				}
+			}
+
+			for(uint16_t character = 0; character < 256; character++) {
+				clusters.occurances[merged_left][character] += clusters.occurances[merged_right][character];
+			}
+
+			clusters.occurances.erase(clusters.occurances.begin() + merged_right);
+
+			for(uint8_t& cluster : clusters.context_map) {
+				if(cluster == merged_right) {
+					cluster = merged_left;
+				} else if(cluster > merged_right) {
+					cluster--;
+				}
+			}
+
+			double cost = clusters_cost(clusters);
+
+			if(cost < best_cost) {
+				best = clusters;
+				best_cost = cost;
+			}
+		}
+
+		return best;
+	}
+
+	// Builds order-1 tables for the block, returning them only if the block takes fewer bits with them than with its own tree
+	void analyze_contexts(Huffman::ByteSpan block, const Huffman::EncodeOptions& options, BlockAnalysis& analysis) {
+		std::vector<Histogram> context_occurances(256, Histogram{});
+		uint8_t previous = 0;
+
+		for(std::byte character : block) {
+			uint8_t current = std::to_integer<uint8_t>(character);
+
+			context_occurances[previous][current]++;
+			previous = current;
+		}
+
+		ContextClusters clusters = cluster_contexts(context_occurances, std::min(options.context_tables, Huffman::ContextModel::MAX_TABLES));
+
+		// A single table codes every character alike, which the tree does at a lower cost
+		if(clusters.occurances.size() < 2) {
+			return;
+		}
+
+		uint8_t max_length = Huffman::ContextModel::MAX_CODE_LENGTH;
+
+		if(options.max_code_length > 0) {
+			max_length = std::min(max_length, options.max_code_length);
+		}
+
+		std::vector<Huffman::Tree::CodeLengths> code_lengths;
+		uint64_t encoded_size = 0;
+
+		for(const Histogram& occurances : clusters.occurances) {
+			Huffman::Tree::CodeLengths lengths = build_tree(occurances).get_code_lengths();
+
+			if(*std::max_element(lengths.begin(), lengths.end()) > max_length) {
+				lengths = limit_code_lengths(occurances, lengths, max_length);
+			}
+
+			for(uint16_t character = 0; character < 256; character++) {
+				encoded_size += occurances[character] * lengths[character];
+			}
+
+			code_lengths.push_back(lengths);
+		}
+
+		auto contexts = std::make_shared<const Huffman::ContextModel>(clusters.context_map, code_lengths);
+		uint64_t contexts_cost = (contexts->serialize().get_byte_length() + 2) * 8;
+
+		uint64_t tree_size = 0;
+
+		for(uint16_t character = 0; character < 256; character++) {
+			tree_size += analysis.occurances[character] * analysis.code_lengths[character];
+		}
+
+		if(contexts_cost + encoded_size < analysis.tree_cost + tree_size) {
+			analysis.contexts = contexts;
+			analysis.contexts_encoded_size = encoded_size;
+		}
+	}
+
+	BlockAnalysis analyze_block(Huffman::ByteSpan block, const Histogram& occurances, const Huffman::EncodeOptions& options) {
+		BlockAnalysis result;
+		result.occurances = occurances;
+		result.run = std::count_if(result.occurances.begin(), result.occurances.end(), [](uint64_t count) {
+			return count > 0;
+		}) == 1;
+
+		result.length_limit_cost = 0;
+
+		// Blocks encoded with a dictionary take its codes, only the occurances are needed to tell runs apart
+		if(result.run || options.dictionary) {
+			return result;
+		}
+
+		HFF_PROFILE_PHASE(Huffman::Phase::TreeBuild);
+
+		result.huffman_tree = build_tree(result.occurances);
+		result.code_lengths = result.huffman_tree->get_code_lengths();
+
+		uint8_t longest_code = *std::max_element(result.code_lengths.begin(), result.code_lengths.end());
+		bool limited = options.max_code_length > 0 && longest_code > options.max_code_length;
+
+		if(limited) {
+			Huffman::Tree::CodeLengths limited_code_lengths = limit_code_lengths(result.occurances, result.code_lengths, options.max_code_length);
+
+			uint64_t unlimited_size = 0;
+			uint64_t limited_size = 0;
+
+			for(uint16_t i = 0; i < result.occurances.size(); i++) {
+				unlimited_size += result.occurances[i] * result.code_lengths[i];
+				limited_size += result.occurances[i] * limited_code_lengths[i];
+			}
+
+			result.length_limit_cost = limited_size - unlimited_size;
+
+			result.code_lengths = limited_code_lengths;
+		} else {
+			ensure_code_lengths_supported(result.code_lengths);
+		}
+
+		// Reshape the tree so that its codes are canonical, limited codes have no tree to begin with
+		if(options.canonical || limited) {
+			result.huffman_tree = Huffman::Tree::from_code_lengths(result.code_lengths);
+		}
+
+		Huffman::Buffer tree_buffer = options.canonical ? result.huffman_tree->serialize_code_lengths() : result.huffman_tree->serialize();
+		result.tree_cost = (tree_buffer.get_byte_length() + 2) * 8;
+
+		if(options.context_tables > 0) {
+			analyze_contexts(block, options, result);
+		}
+
+		return result;
+	}
+
+	// Blocks are cut only at multiples of this many bytes, so that the statistics are counted once for every step
+	const size_t SPLIT_STEP = 8 << 10;
+	// How many steps after a cut the statistics are compared over, no piece of a block is shorter
+	const size_t SPLIT_WINDOW = 4;
+
+	// A part of a block encoded as a block of its own, along with its occurances
+	struct BlockPiece {
+		Huffman::ByteSpan data;
+		Histogram occurances;
+	};
+
+	// How many bits the characters of both histograms save coded apart, each with the ideal code for their own occurances
+	// The ideal size of n characters is n·log(n) minus occurances·log(occurances) for every character, which is worked out in a single pass
+	double split_saving(const Histogram& left, const Histogram& right) {
+		auto size_log_size = [](uint64_t size) {
+			return size > 0 ? size * std::log2(static_cast<double>(size)) : 0.0;
+		};
+
+		uint64_t left_size = 0;
+		uint64_t right_size = 0;
+		double result = 0;
+
+		for(uint16_t i = 0; i < left.size(); i++) {
+			if(left[i] == 0 && right[i] == 0) {
+				continue;
+			}
+
+			left_size += left[i];
+			right_size += right[i];
+			result += size_log_size(left[i]) + size_log_size(right[i]) - size_log_size(left[i] + right[i]);
+		}
+
+		return result + size_log_size(left_size + right_size) - size_log_size(left_size) - size_log_size(right_size);
+	}
+
+	// How many bits one more block with its own tree for the given occurances adds to the message
+	uint64_t split_cost(const Histogram& occurances, const Huffman::EncodeOptions& options) {
+		uint64_t characters = coded_characters(occurances);
+
+		// The flags, the decoded size, the tree size and the message size, along with the block's offset in the footer
+		uint64_t result = (1 + 8 + 2 + 8 + 8) * 8;
+
+		if(options.seek_index) {
+			result += 8 * 8;
+		}
+
+		// The message size is replaced by the number of streams and the size of every stream
+		if(options.streams > 1) {
+			result += (1 + 8 * (options.streams - 1)) * 8;
+		}
+
+		// A tree takes 9 bits for every leaf and a bit for every parent, canonical codes take a pair of bytes for every character or the whole table
+		if(options.canonical) {
+			result += (characters * 2 < 256 ? 1 + characters * 2 : 257) * 8;
+		} else {
+			result += characters * 10 - 1;
+		}
+
+		return result;
+	}
+
+	// How many bits the characters take coded with a Huffman code for their own occurances, limited in length like the block would be
+	uint64_t coded_size(const Histogram& occurances, const Huffman::EncodeOptions& options) {
+		Huffman::Tree::CodeLengths code_lengths = build_tree(occurances).get_code_lengths();
+
+		if(options.max_code_length > 0 && *std::max_element(code_lengths.begin(), code_lengths.end()) > options.max_code_length) {
+			code_lengths = limit_code_lengths(occurances, code_lengths, options.max_code_length);
+		}
+
+		uint64_t result = 0;
+
+		for(uint16_t i = 0; i < occurances.size(); i++) {
+			result += occurances[i] * code_lengths[i];
+		}
+
+		return result;
+	}
+
+	// How many bits cutting between two parts saves, worked out with the code lengths the blocks would actually get
+	// Not cutting leaves the second part to the tree of the first, which is then built for both of them and codes them at least as well
+	// As reusing the tree of the first part for the second would, so a cut has to beat that by more than the new block and its tree cost
+	double cut_saving(const Histogram& before, const Histogram& after, const Huffman::EncodeOptions& options) {
+		Histogram together;
+
+		for(uint16_t i = 0; i < together.size(); i++) {
+			together[i] = before[i] + after[i];
+		}
+
+		double apart_size = static_cast<double>(coded_size(before, options)) + coded_size(after, options) + split_cost(after, options);
+
+		return coded_size(together, options) - apart_size;
+	}
+
+	// Cuts the block where its statistics change, counting the occurances of every piece along the way
+	// Steps through the block with the occurances of the piece so far and of a window rolling right after it, and cuts where coding
+	// the two apart saves more than a new block costs, at the step where the saving peaks
+	// The entropy only estimates the saving, as codes are whole bits long, so the steps it picks are checked with actual codes
+	// The window is only a glimpse of the piece after the cut, so every cut is checked again once the pieces on both sides are known
+	std::vector<BlockPiece> split_block(Huffman::ByteSpan block, const Huffman::EncodeOptions& options) {
+		HFF_PROFILE_PHASE(Huffman::Phase::Histogram);
+
+		std::vector<BlockPiece> result;
+
+		// Blocks encoded with a dictionary have no trees to fit
+		if(!options.adaptive_blocks || options.dictionary) {
+			result.push_back({ block, Huffman::histogram(block.data(), block.size()) });
+
+			return result;
+		}
+
+		size_t steps = (block.size() + SPLIT_STEP - 1) / SPLIT_STEP;
+		std::vector<Histogram> step_occurances(steps);
+
+		for(size_t i = 0; i < steps; i++) {
+			step_occurances[i] = Huffman::histogram(block.data() + i * SPLIT_STEP, std::min(SPLIT_STEP, block.size() - i * SPLIT_STEP));
+		}
+
+		auto add_steps = [&step_occurances](Histogram& occurances, size_t begin, size_t end) {
+			for(size_t step = begin; step < end; step++) {
+				for(uint16_t i = 0; i < occurances.size(); i++) {
+					occurances[i] += step_occurances[step][i];
+				}
+			}
+		};
+
+		auto cut = [&](size_t begin, size_t end) {
+			BlockPiece piece;
+			piece.data = block.subspan(begin * SPLIT_STEP, std::min(end * SPLIT_STEP, block.size()) - begin * SPLIT_STEP);
+			piece.occurances.fill(0);
+			add_steps(piece.occurances, begin, end);
+
+			// Statistics which only seemed to change within the window are put back together
+			if(!result.empty() && cut_saving(result.back().occurances, piece.occurances, options) <= 0) {
+				BlockPiece& previous = result.back();
+				previous.data = block.subspan(previous.data.data() - block.data(), previous.data.size() + piece.data.size());
+
+				for(uint16_t i = 0; i < piece.occurances.size(); i++) {
+					previous.occurances[i] += piece.occurances[i];
+				}
+
+				return;
+			}
+
+			result.push_back(piece);
+		};
+
+		size_t begin = 0;
+
+		while(begin + 2 * SPLIT_WINDOW <= steps) {
+			Histogram piece_occurances;
+			Histogram window_occurances;
+			piece_occurances.fill(0);
+			window_occurances.fill(0);
+
+			add_steps(piece_occurances, begin, begin + SPLIT_WINDOW);
+			add_steps(window_occurances, begin + SPLIT_WINDOW, begin + 2 * SPLIT_WINDOW);
+
+			size_t best_cut = 0;
+			double best_saving = 0;
+
+			for(size_t position = begin + SPLIT_WINDOW; position + SPLIT_WINDOW <= steps; position++) {
+				// The step before the position moves out of the window into the piece
+				if(position > begin + SPLIT_WINDOW) {
+					const Histogram& moved = step_occurances[position - 1];
+					const Histogram& entered = step_occurances[position + SPLIT_WINDOW - 1];
+
+					for(uint16_t i = 0; i < moved.size(); i++) {
+						piece_occurances[i] += moved[i];
+						window_occurances[i] += entered[i] - moved[i];
+					}
+				}
+
+				double saving = split_saving(piece_occurances, window_occurances) - split_cost(window_occurances, options);
+
+				if(saving > best_saving) {
+					saving = cut_saving(piece_occurances, window_occurances, options);
+				}
+
+				if(saving > best_saving) {
+					best_saving = saving;
+					best_cut = position;
+				} else if(best_cut > 0 && position >= best_cut + SPLIT_WINDOW) {
+					// Once the window is past the change, the saving only shrinks
+					break;
+				}
+			}
+
+			if(best_cut == 0) {
+				break;
+			}
+
+			cut(begin, best_cut);
+			begin = best_cut;
+		}
+
+		cut(begin, steps);
+
+		return result;
+	}
+
+	// Encodes the block as a single stream, or as consecutive segments of equal size each encoded as a separate stream
+	// Every stream but the last is padded to whole bytes, so that the decoder can find where the next one starts
+	void encode_block(Huffman::ByteSpan block, const Huffman::Tree::CodeTable& code_table, uint64_t encoded_size,
+		size_t streams_num, Huffman::EncodedMessage::Block& encoded_block) {
+		Huffman::BitWriter writer(encoded_size / 8 + streams_num);
+
+		auto encode_segment = [&](size_t begin, size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				const Huffman::Tree::CodeWord& code = code_table[std::to_integer<uint8_t>(block[i])];
+
+				writer.write(code.bits, code.length);
+			}
+		};
+
+		encoded_block.stream_lengths.clear();
+
+		if(streams_num == 1) {
+			encode_segment(0, block.size());
+		} else {
+			size_t segment_size = block.size() / streams_num + (block.size() % streams_num > 0);
+
+			for(size_t i = 0; i < streams_num; i++) {
+				uint64_t stream_begin = writer.get_length();
+
+				encode_segment(std::min(block.size(), i * segment_size), std::min(block.size(), (i + 1) * segment_size));
+
+				encoded_block.stream_lengths.push_back(writer.get_length() - stream_begin);
+				writer.align();
+			}
+		}
+
+		encoded_block.message_buffer = writer.finish();
+	}
+
+	// Decides for consecutive blocks whether a new tree pays off or the previous one can be reused
+	class TreeSelector {
+		bool m_HasTree;
+		Huffman::Tree::CodeLengths m_CodeLengths;
+		std::shared_ptr<const Huffman::Tree::CodeTable> m_CodeTable;
+		uint64_t m_EncodedSize;
+
+	public:
+		TreeSelector()
+			: m_HasTree(false), m_EncodedSize(0) {
+			m_CodeLengths.fill(0);
+		}
+
+		// Returns the new tree the block is encoded with, or nothing if the previous tree is reused
+		std::optional<Huffman::Tree> select(BlockAnalysis& analysis) {
+			// Compare the size of the block encoded with the new tree (including the tree itself)
+			// To its size when encoded with the previous tree
+			uint64_t new_tree_size = 0;
+			uint64_t previous_tree_size = 0;
+			bool previous_tree_usable = m_HasTree;
+
+			for(uint16_t i = 0; i < analysis.occurances.size(); i++) {
+				new_tree_size += analysis.occurances[i] * analysis.code_lengths[i];
+				previous_tree_size += analysis.occurances[i] * m_CodeLengths[i];
+
+				if(analysis.occurances[i] > 0 && m_CodeLengths[i] == 0) {
+					previous_tree_usable = false;
+				}
+			}
+
+			if(previous_tree_usable && analysis.tree_cost + new_tree_size >= previous_tree_size) {
+				m_EncodedSize = previous_tree_size;
+
+				return std::nullopt;
+			}
+
+			m_HasTree = true;
+			m_CodeLengths = analysis.code_lengths;
+			m_CodeTable = std::make_shared<const Huffman::Tree::CodeTable>(analysis.huffman_tree->get_code_table());
+			m_EncodedSize = new_tree_size;
+
+			return std::move(analysis.huffman_tree);
+		}
+
+		// The codes of the tree selected last
+		std::shared_ptr<const Huffman::Tree::CodeTable> get_code_table() const {
+			return m_CodeTable;
+		}
+
+		// The size of the last block (in bits) encoded with the selected tree
+		uint64_t get_encoded_size() const {
+			return m_EncodedSize;
+		}
+	};
+
+	// Runs the function for every index, spread over the pool if there is one
+	template <typename Function>
+	void for_each_index(Huffman::ThreadPool* pool, size_t count, Function function) {
+		if(!pool) {
+			for(size_t i = 0; i < count; i++) {
+				function(i);
+			}
+
+			return;
+		}
+
+		std::vector<std::future<void>> results;
+
+		for(size_t i = 0; i < count; i++) {
+			results.push_back(pool->submit([&function, i]() { function(i); }));
+		}
+
+		// Wait for every task before rethrowing, as they refer to the caller's data
+		for(std::future<void>& result : results) {
+			result.wait();
+		}
+
+		for(std::future<void>& result : results) {
+			result.get();
+		}
+	}
+
+	// Every character takes at least a bit, which rules out corrupted lengths too large to allocate
+	void check_block_length(const Huffman::EncodedMessage::Block& block, const Huffman::MessageView& message) {
+		if(block.run) {
+			return;
+		}
+
+		uint64_t message_length = 0;
+
+		for(uint64_t stream_length : message.stream_lengths) {
+			message_length += stream_length;
+		}
+
+		if(block.length > message_length) {
+			throw Huffman::EncodedMessage::InvalidBlockLengthException();
+		}
+	}
+
+	// Decodes a block of known length straight into the output, which has to be exactly as long as the block
+	// Runs are filled in without looking at any bits, the table is used only for the other blocks
+	void decode_block(const Huffman::EncodedMessage::Block& block, const Huffman::MessageView& message, const Huffman::DecodeTable* table, Huffman::MutableByteSpan output) {
+		HFF_PROFILE_COUNT(Huffman::Counter::Blocks, 1);
+		HFF_PROFILE_COUNT(Huffman::Counter::Symbols, output.size());
+		HFF_PROFILE_COUNT(Huffman::Counter::EncodedBits, std::accumulate(message.stream_lengths.begin(), message.stream_lengths.end(), uint64_t(0)));
+
+		if(block.run) {
+			std::memset(output.data(), block.run_character, output.size());
+		} else if(block.contexts) {
+			if(message.stream_lengths.size() != 1 || !block.contexts->decode(message.bytes, message.stream_lengths[0], output)) {
+				throw Huffman::EncodedMessage::InvalidBlockLengthException();
+			}
+		} else if(!table->decode_streams(message.bytes, message.stream_lengths, output)) {
+			throw Huffman::EncodedMessage::InvalidBlockLengthException();
+		}
+
+		// The stored content was checked as the block was read, this catches whatever slipped through decoding
+		if(block.checksum && Huffman::crc32c(output.data(), output.size()) != *block.checksum) {
+			throw Huffman::EncodedMessage::ChecksumMismatchException();
+		}
+	}
+
+	// Decodes the block into the output, replacing its content
+	// The message is taken from the block, unless it's left in place and given as `message`
+	void decode_block(const Huffman::EncodedMessage::Block& block, const Huffman::MessageView* message, const Huffman::DecodeTable* table, std::string& output) {
+		Huffman::MessageView block_message;
+
+		if(message == nullptr) {
+			block_message.bytes = Huffman::ByteSpan(block.message_buffer.data(), block.message_buffer.get_byte_length());
+			block_message.stream_lengths = block.stream_lengths;
+
+			if(block_message.stream_lengths.empty()) {
+				block_message.stream_lengths.push_back(block.message_buffer.get_length());
+			}
+
+			message = &block_message;
+		}
+
+		// Blocks of older versions don't know their length until they're decoded
+		if(block.length == Huffman::EncodedMessage::Block::UNKNOWN_LENGTH) {
+			output.clear();
+			table->decode(block.message_buffer, output);
+
+			HFF_PROFILE_COUNT(Huffman::Counter::Blocks, 1);
+			HFF_PROFILE_COUNT(Huffman::Counter::Symbols, output.size());
+			HFF_PROFILE_COUNT(Huffman::Counter::EncodedBits, block.message_buffer.get_length());
+
+			return;
+		}
+
+		check_block_length(block, *message);
+
+		output.resize(block.length);
+		decode_block(block, *message, table, Huffman::MutableByteSpan(reinterpret_cast<std::byte*>(output.data()), output.size()));
+	}
+
+	std::unique_ptr<Huffman::ThreadPool> make_pool(size_t threads) {
+		return threads > 1 ? std::make_unique<Huffman::ThreadPool>(threads) : nullptr;
+	}
+
+	// How many blocks are kept in memory at once, enough to keep every thread busy
+	size_t blocks_in_flight(size_t threads) {
+		return threads > 1 ? threads * 2 : 1;
 	}
 
-	if(!multiple_chars) {
-		// Unfortunately we have to do that because of how we store the data
-		// If we stored the length of the original message instead of the message buffer
-		// We would be able to reconstruct the message, but that would require a rework
-		// Of the `EncodedMessage` class
-		throw OneCharacterSourceException();
+	// Encodes the input block by block, passing every block to `on_block` in order along with its new tree, if any
+	// `read_block` gets the index of a block within the batch and returns the next block, empty at the end of the input
+	// The block has to stay valid until the next batch is read
+	// The tree indices of the blocks are left for `on_block` to fill in
+	template <typename ReadBlock, typename OnBlock>
+	void encode_blocks(ReadBlock read_block, const Huffman::EncodeOptions& options, Huffman::EncodeStats& stats, OnBlock on_block) {
+		// The number of streams is stored in a byte
+		if(options.streams == 0 || options.streams > UINT8_MAX) {
+			throw std::invalid_argument("The number of streams has to be between 1 and 255.");
+		}
+
+		// Shorter limits can't fit codes for all 256 characters
+		if(options.max_code_length != 0 && (options.max_code_length < 8 || options.max_code_length > Huffman::Tree::MAX_CODE_LENGTH)) {
+			throw std::invalid_argument("The code length limit has to be between 8 and " + std::to_string(Huffman::Tree::MAX_CODE_LENGTH) + ".");
+		}
+
+		// The index of a table is stored in a few bits, a single table would code every character alike
+		if(options.context_tables == 1 || options.context_tables > Huffman::ContextModel::MAX_TABLES) {
+			throw std::invalid_argument("The number of order-1 tables has to be between 2 and " + std::to_string(Huffman::ContextModel::MAX_TABLES) + ".");
+		}
+
+		auto pool = make_pool(options.threads);
+		TreeSelector selector;
+
+		// The codes of the dictionary are shared by every block, without copying them
+		std::shared_ptr<const Huffman::Tree::CodeTable> dictionary_table;
+
+		if(options.dictionary) {
+			dictionary_table = std::shared_ptr<const Huffman::Tree::CodeTable>(options.dictionary, &options.dictionary->get_code_table());
+		}
+
+		std::vector<Huffman::ByteSpan> blocks(blocks_in_flight(options.threads));
+		std::vector<std::vector<BlockPiece>> block_pieces(blocks.size());
+
+		// Every piece of the blocks read is encoded as a block of its own
+		std::vector<BlockPiece> pieces;
+		std::vector<BlockAnalysis> analyses;
+		std::vector<std::shared_ptr<const Huffman::Tree::CodeTable>> code_tables;
+		std::vector<uint64_t> encoded_sizes;
+		std::vector<std::optional<Huffman::Tree>> trees;
+		std::vector<Huffman::EncodedMessage::Block> encoded_blocks;
+
+		bool finished = false;
+
+		while(!finished) {
+			// Read a batch of blocks
+			size_t blocks_num = 0;
+
+			for(; blocks_num < blocks.size(); blocks_num++) {
+				HFF_PROFILE_PHASE(Huffman::Phase::Read);
+
+				blocks[blocks_num] = read_block(blocks_num);
+				HFF_PROFILE_COUNT(Huffman::Counter::BytesIn, blocks[blocks_num].size());
+
+				if(blocks[blocks_num].empty()) {
+					finished = true;
+					break;
+				}
+			}
+
+			// Counting, cutting and building trees is independent for every block
+			for_each_index(pool.get(), blocks_num, [&](size_t i) {
+				block_pieces[i] = split_block(blocks[i], options);
+			});
+
+			pieces.clear();
+
+			for(size_t i = 0; i < blocks_num; i++) {
+				pieces.insert(pieces.end(), block_pieces[i].begin(), block_pieces[i].end());
+				stats.splits += block_pieces[i].size() - 1;
+			}
+
+			size_t pieces_num = pieces.size();
+
+			analyses.resize(pieces_num);
+			code_tables.resize(pieces_num);
+			encoded_sizes.resize(pieces_num);
+			trees.resize(pieces_num);
+			encoded_blocks.resize(pieces_num);
+
+			for_each_index(pool.get(), pieces_num, [&](size_t i) {
+				analyses[i] = analyze_block(pieces[i].data, pieces[i].occurances, options);
+			});
+
+			// Choosing between the new and the previous tree depends on the blocks before
+			// Runs are stored on their own, without affecting the choice for the blocks after them
+			for(size_t i = 0; i < pieces_num; i++) {
+				HFF_PROFILE_PHASE(Huffman::Phase::CodeGeneration, stats.blocks);
+
+				Huffman::ByteSpan block = pieces[i].data;
+
+				Huffman::EncodedMessage::Block& encoded_block = encoded_blocks[i];
+				encoded_block.length = block.size();
+				encoded_block.run = analyses[i].run;
+				encoded_block.run_character = std::to_integer<uint8_t>(block[0]);
+
+				encoded_block.contexts = analyses[i].contexts;
+
+				stats.input_size += block.size();
+				stats.blocks++;
+				stats.length_limit_cost += analyses[i].length_limit_cost;
+
+				if(analyses[i].run) {
+					trees[i].reset();
+					stats.run_blocks++;
+					continue;
+				}
+
+				// Blocks with their own order-1 tables are left out of the choice of tree, like runs
+				if(analyses[i].contexts) {
+					trees[i].reset();
+					encoded_sizes[i] = analyses[i].contexts_encoded_size;
+					stats.context_blocks++;
+					continue;
+				}
+
+				if(dictionary_table) {
+					const Huffman::Tree::CodeLengths& code_lengths = options.dictionary->get_code_lengths();
+
+					trees[i].reset();
+					code_tables[i] = dictionary_table;
+					encoded_sizes[i] = 0;
+
+					for(uint16_t j = 0; j < code_lengths.size(); j++) {
+						encoded_sizes[i] += analyses[i].occurances[j] * code_lengths[j];
+					}
+
+					continue;
+				}
+
+				trees[i] = selector.select(analyses[i]);
+				code_tables[i] = selector.get_code_table();
+				encoded_sizes[i] = selector.get_encoded_size();
+
+				if(trees[i]) {
+					stats.trees++;
+				}
+			}
+
+			for_each_index(pool.get(), pieces_num, [&](size_t i) {
+				HFF_PROFILE_PHASE(Huffman::Phase::BitPacking, stats.blocks - pieces_num + i);
+				HFF_PROFILE_COUNT(Huffman::Counter::Blocks, 1);
+				HFF_PROFILE_COUNT(Huffman::Counter::Symbols, pieces[i].data.size());
+				HFF_PROFILE_COUNT(Huffman::Counter::EntropyBits, Huffman::entropy(analyses[i].occurances) * pieces[i].data.size());
+
+				// The checksums of runs are worked out as they're written, without their content
+				if(options.checksums && !analyses[i].run) {
+					encoded_blocks[i].checksum = Huffman::crc32c(pieces[i].data.data(), pieces[i].data.size());
+				} else {
+					encoded_blocks[i].checksum.reset();
+				}
+
+				if(analyses[i].run) {
+					encoded_blocks[i].message_buffer = Huffman::Buffer();
+					encoded_blocks[i].stream_lengths.clear();
+				} else if(analyses[i].contexts) {
+					encoded_blocks[i].message_buffer = analyses[i].contexts->encode(pieces[i].data, encoded_sizes[i]);
+					encoded_blocks[i].stream_lengths.clear();
+					HFF_PROFILE_COUNT(Huffman::Counter::EncodedBits, encoded_sizes[i]);
+				} else {
+					encode_block(pieces[i].data, *code_tables[i], encoded_sizes[i], options.streams, encoded_blocks[i]);
+					HFF_PROFILE_COUNT(Huffman::Counter::EncodedBits, encoded_sizes[i]);
+				}
+			});
+
+			for(size_t i = 0; i < pieces_num; i++) {
+				HFF_PROFILE_PHASE(Huffman::Phase::Serialize, stats.blocks - pieces_num + i);
+
+				on_block(trees[i], encoded_blocks[i]);
+			}
+		}
 	}
 
-	// Create a list of one-node Huffman trees to store the characters with their probablities (occurence count)
-	// Using a priority queue to mitigate the cost of looking for the least probable character in each iteration
-	auto tree_priority_cmp = [](const Tree& left, const Tree& right) {
-		return left.get_occurances() > right.get_occurances();
+	// Reads the blocks of a stream into buffers reused for every batch
+	class StreamBlockReader {
+		std::istream& m_Input;
+		size_t m_BlockSize;
+		std::vector<std::vector<std::byte>> m_Buffers;
+
+	public:
+		StreamBlockReader(std::istream& input, const Huffman::EncodeOptions& options)
+			: m_Input(input), m_BlockSize(options.block_size), m_Buffers(blocks_in_flight(options.threads)) {}
+
+		Huffman::ByteSpan operator()(size_t index) {
+			std::vector<std::byte>& buffer = m_Buffers[index];
+			buffer.resize(m_BlockSize);
+
+			m_Input.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+
+			return Huffman::ByteSpan(buffer.data(), m_Input.gcount());
+		}
+	};
+
+	// Cuts the blocks out of memory, without copying them
+	class SpanBlockReader {
+		Huffman::ByteSpan m_Input;
+		size_t m_BlockSize;
+		size_t m_Offset;
+
+	public:
+		SpanBlockReader(Huffman::ByteSpan input, const Huffman::EncodeOptions& options)
+			: m_Input(input), m_BlockSize(options.block_size), m_Offset(0) {}
+
+		Huffman::ByteSpan operator()(size_t) {
+			size_t size = std::min(m_BlockSize, m_Input.size() - m_Offset);
+			Huffman::ByteSpan result = m_Input.subspan(m_Offset, size);
+			m_Offset += size;
+
+			return result;
+		}
 	};
 
-	std::priority_queue<Tree, std::vector<Tree>, decltype(tree_priority_cmp)> tree_queue(tree_priority_cmp);
+	// Writes every block to the container as soon as it's encoded
+	template <typename ReadBlock>
+	void encode_to_container(ReadBlock read_block, Huffman::OutputSink& output, const Huffman::EncodeOptions& options, Huffman::EncodeStats& stats) {
+		std::optional<uint32_t> dictionary_id;
+
+		if(options.dictionary) {
+			dictionary_id = options.dictionary->get_id();
+		}
+
+		Huffman::ContainerWriter writer(output, options.canonical, options.seek_index, dictionary_id, false, options.checksums);
+
+		encode_blocks(read_block, options, stats, [&writer](std::optional<Huffman::Tree>& huffman_tree, Huffman::EncodedMessage::Block& block) {
+			if(block.run) {
+				writer.write_run(block.run_character, block.length);
+			} else if(block.contexts) {
+				writer.write_contexts_block(block);
+			} else if(huffman_tree) {
+				writer.write_block(*huffman_tree, block);
+			} else {
+				writer.write_block(block);
+			}
+		});
+
+		writer.finish();
+
+		stats.output_size = writer.get_bytes_written();
+	}
+
+	// Messages encoded with a dictionary start out with its table, they can be decoded only with the very same dictionary
+	std::shared_ptr<const Huffman::DecodeTable> dictionary_table(const Huffman::ContainerReader& reader, const Huffman::DecodeOptions& options) {
+		std::optional<uint32_t> dictionary_id = reader.get_dictionary_id();
+
+		if(!dictionary_id) {
+			return nullptr;
+		}
+
+		if(!options.dictionary) {
+			throw Huffman::EncodedMessage::MissingDictionaryException(*dictionary_id);
+		}
+
+		if(options.dictionary->get_id() != *dictionary_id) {
+			throw Huffman::EncodedMessage::WrongDictionaryException(*dictionary_id, options.dictionary->get_id());
+		}
+
+		return options.dictionary->get_decode_table();
+	}
+
+	// Takes whatever the input has at hand, waiting only for the first byte, so that a slow input is passed on as it comes
+	size_t read_available(std::istream& input, std::byte* data, size_t size) {
+		std::streambuf* buffer = input.rdbuf();
+
+		if(buffer->sgetc() == std::char_traits<char>::eof()) {
+			return 0;
+		}
+
+		size_t result = 0;
+
+		while(result < size) {
+			std::streamsize available = buffer->in_avail();
+
+			if(available <= 0) {
+				break;
+			}
+
+			result += buffer->sgetn(reinterpret_cast<char*>(data + result), std::min<uint64_t>(available, size - result));
+		}
+
+		return result;
+	}
+
+	// Decodes the blocks of the container in batches, building the lookup table once per tree
+	// Messages held in memory are decoded in place, without copying the encoded messages of the blocks
+	void decode_container(Huffman::ContainerReader& reader, bool in_place, std::ostream& output, const Huffman::DecodeOptions& options) {
+		using namespace Huffman;
+
+		auto pool = make_pool(options.threads);
+
+		std::optional<Tree> huffman_tree;
+		std::shared_ptr<const DecodeTable> table = dictionary_table(reader, options);
+
+		std::vector<std::shared_ptr<const DecodeTable>> tables(blocks_in_flight(options.threads));
+		std::vector<EncodedMessage::Block> blocks(tables.size());
+		std::vector<MessageView> messages(tables.size());
+		std::vector<std::string> decoded_blocks(tables.size());
+
+		bool finished = false;
+
+		while(!finished) {
+			size_t blocks_num = 0;
+
+			for(; blocks_num < tables.size(); blocks_num++) {
+				bool read = in_place
+					? reader.read_block(huffman_tree, blocks[blocks_num], messages[blocks_num])
+					: reader.read_block(huffman_tree, blocks[blocks_num]);
+
+				if(!read) {
+					finished = true;
+					break;
+				}
+
+				if(huffman_tree) {
+					table = std::make_shared<const DecodeTable>(make_table(*huffman_tree, reader.is_canonical()));
+				}
+
+				tables[blocks_num] = table;
+			}
+
+			for_each_index(pool.get(), blocks_num, [&](size_t i) {
+				HFF_PROFILE_PHASE(Phase::Decode, reader.get_blocks_read() - blocks_num + i);
+
+				decode_block(blocks[i], in_place ? &messages[i] : nullptr, tables[i].get(), decoded_blocks[i]);
+			});
+
+			for(size_t i = 0; i < blocks_num; i++) {
+				HFF_PROFILE_PHASE(Phase::Write);
+
+				output.write(decoded_blocks[i].data(), decoded_blocks[i].size());
+				HFF_PROFILE_COUNT(Counter::BytesOut, decoded_blocks[i].size());
+			}
+		}
+	}
+}
+
+Huffman::Dictionary Huffman::train_dictionary(const Histogram& occurances) {
+	return Dictionary(complete_code_lengths(occurances));
+}
+
+Huffman::EncodedMessage Huffman::encode(std::istream& input, const EncodeOptions& options) {
+	if(options.dictionary) {
+		throw std::invalid_argument("Messages held in memory can't be encoded with a dictionary.");
+	}
+
+	EncodedMessage result;
+	result.canonical = options.canonical;
+
+	EncodeStats stats;
+
+	encode_blocks(StreamBlockReader(input, options), options, stats, [&result](std::optional<Tree>& huffman_tree, EncodedMessage::Block& block) {
+		if(huffman_tree) {
+			result.trees.push_back(std::move(*huffman_tree));
+		}
+
+		block.tree_index = result.trees.size() - 1;
+		result.blocks.push_back(std::move(block));
+	});
+
+	return result;
+}
+
+void Huffman::encode(std::istream& input, std::ostream& output, const EncodeOptions& options) {
+	EncodeStats stats;
+
+	encode(input, output, options, stats);
+}
+
+void Huffman::encode(std::istream& input, std::ostream& output, const EncodeOptions& options, EncodeStats& stats) {
+	StreamSink sink(output);
+
+	encode_to_container(StreamBlockReader(input, options), sink, options, stats);
+}
+
+void Huffman::encode(ByteSpan input, OutputSink& output, const EncodeOptions& options) {
+	EncodeStats stats;
+
+	encode(input, output, options, stats);
+}
+
+void Huffman::encode(ByteSpan input, OutputSink& output, const EncodeOptions& options, EncodeStats& stats) {
+	encode_to_container(SpanBlockReader(input, options), output, options, stats);
+}
+
+void Huffman::encode_stream(std::istream& input, OutputSink& output, const EncodeOptions& options) {
+	EncodeStats stats;
+
+	encode_stream(input, output, options, stats);
+}
+
+void Huffman::encode_stream(std::istream& input, OutputSink& output, const EncodeOptions& options, EncodeStats& stats) {
+	if(options.streams == 0 || options.streams > UINT8_MAX) {
+		throw std::invalid_argument("The number of streams has to be between 1 and 255.");
+	}
+
+	if(options.seek_index) {
+		throw std::invalid_argument("The seek index can't be stored in a single pass.");
+	}
+
+	if(options.context_tables > 0) {
+		throw std::invalid_argument("Order-1 tables can't be built in a single pass.");
+	}
+
+	std::optional<uint32_t> dictionary_id;
+
+	if(options.dictionary) {
+		dictionary_id = options.dictionary->get_id();
+	}
+
+	// Trees built from code lengths are canonical, so only their lengths are stored
+	ContainerWriter writer(output, true, false, dictionary_id, true, options.checksums);
+
+	// The first rebuilds come early, so that short inputs get codes fit for them
+	const uint64_t first_rebuild_interval = 4 << 10;
+
+	uint64_t rebuild_interval = std::min<uint64_t>(first_rebuild_interval, options.block_size);
+	Histogram window_occurances;
+	window_occurances.fill(0);
+	uint64_t window_size = 0;
+
+	Tree::CodeLengths code_lengths;
+	std::optional<Tree> new_tree;
+
+	if(options.dictionary) {
+		code_lengths = options.dictionary->get_code_lengths();
+	} else {
+		code_lengths.fill(8);
+		new_tree = Tree::from_code_lengths(code_lengths);
+	}
+
+	Tree::CodeTable code_table = options.dictionary ? options.dictionary->get_code_table() : new_tree->get_code_table();
+
+	std::vector<std::byte> buffer(options.block_size);
+	EncodedMessage::Block encoded_block;
+
+	while(true) {
+		// Blocks end where the codes are rebuilt, so that the codes always come from the input before the block
+		size_t size;
+
+		{
+			HFF_PROFILE_PHASE(Phase::Read);
+
+			size = read_available(input, buffer.data(), rebuild_interval - window_size);
+			HFF_PROFILE_COUNT(Counter::BytesIn, size);
+		}
+
+		if(size == 0) {
+			break;
+		}
+
+		ByteSpan block(buffer.data(), size);
+		Histogram occurances;
+
+		{
+			HFF_PROFILE_PHASE(Phase::Histogram, stats.blocks);
+
+			occurances = histogram(block.data(), block.size());
+		}
+
+		HFF_PROFILE_COUNT(Counter::Blocks, 1);
+		HFF_PROFILE_COUNT(Counter::Symbols, size);
+		HFF_PROFILE_COUNT(Counter::EntropyBits, entropy(occurances) * size);
+
+		stats.input_size += size;
+		stats.blocks++;
+
+		if(occurances[std::to_integer<uint8_t>(block[0])] == size) {
+			HFF_PROFILE_PHASE(Phase::Serialize, stats.blocks - 1);
+
+			writer.write_run(std::to_integer<uint8_t>(block[0]), size);
+			stats.run_blocks++;
+		} else {
+			uint64_t encoded_size = 0;
+
+			for(uint16_t i = 0; i < occurances.size(); i++) {
+				encoded_size += occurances[i] * code_lengths[i];
+			}
+
+			encoded_block.length = size;
+
+			if(options.checksums) {
+				encoded_block.checksum = crc32c(block.data(), block.size());
+			}
+
+			{
+				HFF_PROFILE_PHASE(Phase::BitPacking, stats.blocks - 1);
+
+				encode_block(block, code_table, encoded_size, options.streams, encoded_block);
+				HFF_PROFILE_COUNT(Counter::EncodedBits, encoded_size);
+			}
+
+			HFF_PROFILE_PHASE(Phase::Serialize, stats.blocks - 1);
+
+			// A new tree is stored with the first block encoded with it
+			if(new_tree) {
+				writer.write_block(*new_tree, encoded_block);
+				new_tree.reset();
+				stats.trees++;
+			} else {
+				writer.write_block(encoded_block);
+			}
+		}
+
+		writer.flush();
+
+		for(uint16_t i = 0; i < occurances.size(); i++) {
+			window_occurances[i] += occurances[i];
+		}
+
+		window_size += size;
+
+		// The decoder doesn't need to know when the codes change, the next block which isn't a run carries the new tree
+		if(window_size >= rebuild_interval) {
+			HFF_PROFILE_PHASE(Phase::TreeBuild);
+
+			code_lengths = complete_code_lengths(window_occurances);
+			new_tree = Tree::from_code_lengths(code_lengths);
+			code_table = new_tree->get_code_table();
+
+			window_occurances.fill(0);
+			window_size = 0;
+			rebuild_interval = std::min<uint64_t>(rebuild_interval * 2, options.block_size);
+		}
+	}
+
+	writer.finish();
+	writer.flush();
+
+	stats.output_size = writer.get_bytes_written();
+}
+
+void Huffman::decode(const EncodedMessage& input, std::ostream& output, const DecodeOptions& options) {
+	auto pool = make_pool(options.threads);
+
+	std::vector<std::shared_ptr<const DecodeTable>> tables(input.blocks.size());
+	std::vector<std::string> decoded_blocks(blocks_in_flight(options.threads));
+
+	// Build the lookup table once per tree, runs don't need one
+	std::shared_ptr<const DecodeTable> table;
+	size_t table_tree_index = 0;
+
+	for(size_t i = 0; i < input.blocks.size(); i++) {
+		const EncodedMessage::Block& block = input.blocks[i];
+
+		if(block.run || block.contexts) {
+			continue;
+		}
+
+		if(!table || table_tree_index != block.tree_index) {
+			table = std::make_shared<const DecodeTable>(make_table(input.trees[block.tree_index], input.canonical));
+			table_tree_index = block.tree_index;
+		}
+
+		tables[i] = table;
+	}
+
+	for(size_t first = 0; first < input.blocks.size(); first += decoded_blocks.size()) {
+		size_t blocks_num = std::min(decoded_blocks.size(), input.blocks.size() - first);
+
+		for_each_index(pool.get(), blocks_num, [&](size_t i) {
+			HFF_PROFILE_PHASE(Phase::Decode, first + i);
+
+			decode_block(input.blocks[first + i], nullptr, tables[first + i].get(), decoded_blocks[i]);
+		});
+
+		for(size_t i = 0; i < blocks_num; i++) {
+			HFF_PROFILE_PHASE(Phase::Write);
+
+			output.write(decoded_blocks[i].data(), decoded_blocks[i].size());
+			HFF_PROFILE_COUNT(Counter::BytesOut, decoded_blocks[i].size());
+		}
+	}
+}
+
+void Huffman::decode(std::istream& input, std::ostream& output, const DecodeOptions& options) {
+	ContainerReader reader(input);
+
+	decode_container(reader, false, output, options);
+}
+
+void Huffman::decode(ByteSpan input, std::ostream& output, const DecodeOptions& options) {
+	ContainerReader reader(input);
+
+	decode_container(reader, true, output, options);
+}
+
+uint64_t Huffman::decoded_size(ByteSpan input) {
+	ContainerReader reader(input);
 
-	for(uint16_t i = 0; i < occurances.size(); i++) {
-		if(occurances[i] > 0) {
-			tree_queue.emplace(i + 1, occurances[i]);
+	std::optional<Tree> huffman_tree;
+	std::optional<DecodeTable> table;
+	EncodedMessage::Block block;
+	MessageView message;
+	std::string decoded_block;
+
+	uint64_t result = 0;
+
+	while(reader.read_block(huffman_tree, block, message)) {
+		if(block.length != EncodedMessage::Block::UNKNOWN_LENGTH) {
+			check_block_length(block, message);
+
+			result += block.length;
+			continue;
+		}
+
+		// Blocks of older versions have to be decoded to find out
+		if(huffman_tree) {
+			table.emplace(make_table(*huffman_tree, reader.is_canonical()));
 		}
+
+		decode_block(block, &message, &*table, decoded_block);
+		result += decoded_block.size();
 	}
 
-	// Fuse the trees into one Huffman tree
-	while(tree_queue.size() > 1) {
-		// We have to do it this way because of reasons explained below
-		// https://stackoverflow.com/questions/20149471/move-out-element-of-std-priority-queue-in-c11
-		Tree tree1 = std::move(const_cast<Tree&>(tree_queue.top()));
-		tree_queue.pop();
+	return result;
+}
+
+void Huffman::decode_range(ByteSpan input, uint64_t offset, uint64_t length, std::ostream& output, const DecodeOptions& options) {
+	ContainerReader reader(input);
+	BlockIndex index = reader.read_index();
+
+	// The range is cut short at the end of the decoded content
+	auto write_range = [&](const std::string& decoded, uint64_t decoded_offset) {
+		uint64_t begin = std::max(offset, decoded_offset);
+		uint64_t end = std::min(offset + std::min(length, UINT64_MAX - offset), decoded_offset + decoded.size());
+
+		if(begin < end) {
+			HFF_PROFILE_PHASE(Phase::Write);
+
+			output.write(decoded.data() + (begin - decoded_offset), end - begin);
+			HFF_PROFILE_COUNT(Counter::BytesOut, end - begin);
+		}
+	};
+
+	// Without the lengths of the blocks there's no telling where the range is
+	if(index.block_offsets.empty() || index.block_ends.size() != index.block_offsets.size()) {
+		std::string decoded(decoded_size(input), '\0');
+		decode(input, MutableByteSpan(reinterpret_cast<std::byte*>(decoded.data()), decoded.size()), options);
+
+		write_range(decoded, 0);
 
-		Tree tree2 = std::move(const_cast<Tree&>(tree_queue.top()));
-		tree_queue.pop();
+		return;
+	}
+
+	// The range covers the blocks from the first one ending after its start to the first one ending at or after its end
+	size_t first = std::upper_bound(index.block_ends.begin(), index.block_ends.end(), offset) - index.block_ends.begin();
 
-		Tree new_tree(std::move(tree1), std::move(tree2));
-		tree_queue.push(std::move(new_tree));
+	if(length == 0 || first == index.block_ends.size()) {
+		return;
 	}
 
-	Tree huffman_tree = std::move(const_cast<Tree&>(tree_queue.top()));
+	uint64_t range_end = offset + std::min(length, UINT64_MAX - offset);
+	size_t last = std::min<size_t>(std::lower_bound(index.block_ends.begin(), index.block_ends.end(), range_end) - index.block_ends.begin(), index.block_ends.size() - 1);
+
+	// Reading starts at the block carrying the tree of the first block, the blocks before the range are only read
+	size_t block_index = reader.seek_block(index, first);
+
+	auto pool = make_pool(options.threads);
+
+	std::optional<Tree> huffman_tree;
+	std::shared_ptr<const DecodeTable> table = dictionary_table(reader, options);
+
+	std::vector<std::shared_ptr<const DecodeTable>> tables(blocks_in_flight(options.threads));
+	std::vector<EncodedMessage::Block> blocks(tables.size());
+	std::vector<MessageView> messages(tables.size());
+	std::vector<std::string> decoded_blocks(tables.size());
+	std::vector<uint64_t> decoded_offsets(tables.size());
+
+	while(block_index <= last) {
+		size_t blocks_num = 0;
+
+		for(; blocks_num < tables.size() && block_index <= last; block_index++) {
+			if(!reader.read_block(huffman_tree, blocks[blocks_num], messages[blocks_num])) {
+				throw EncodedMessage::InvalidBlockIndexException();
+			}
 
-	// Get the code as a dictionary
-	Huffman::Tree::CodeDictionary code_dictionary = huffman_tree.get_codes();
+			if(huffman_tree) {
+				table = std::make_shared<const DecodeTable>(make_table(*huffman_tree, reader.is_canonical()));
+			}
 
-	// Encode the message into a bit buffer
-	Buffer buffer;
+			if(block_index < first) {
+				continue;
+			}
 
-	for(char current : message) {
-		auto code = code_dictionary[current];
+			// The seek index has to agree with the blocks themselves
+			decoded_offsets[blocks_num] = block_index > 0 ? index.block_ends[block_index - 1] : 0;
 
-		buffer <<= code;
+			if(blocks[blocks_num].length != index.block_ends[block_index] - decoded_offsets[blocks_num]) {
+				throw EncodedMessage::InvalidBlockIndexException();
+			}
+
+			tables[blocks_num] = table;
+			blocks_num++;
+		}
+
+		for_each_index(pool.get(), blocks_num, [&](size_t i) {
+			HFF_PROFILE_PHASE(Phase::Decode, block_index - blocks_num + i);
+
+			decode_block(blocks[i], &messages[i], tables[i].get(), decoded_blocks[i]);
+		});
+
+		for(size_t i = 0; i < blocks_num; i++) {
+			write_range(decoded_blocks[i], decoded_offsets[i]);
+		}
 	}
+}
+
+Huffman::VerifyStats Huffman::verify(ByteSpan input) {
+	ContainerReader reader(input);
 
-	EncodedMessage result = { std::move(huffman_tree), std::move(buffer) };
+	VerifyStats result;
+	result.checksums = reader.has_checksums();
+
+	// Blocks are checked against their checksums as they're read, their encoded messages are left in place
+	std::optional<Tree> huffman_tree;
+	EncodedMessage::Block block;
+	MessageView message;
+
+	while(reader.read_block(huffman_tree, block, message)) {
+		result.blocks++;
+	}
 
 	return result;
 }
 
-void Huffman::decode(const EncodedMessage& input, std::ostream& output) {
-	// Get the code as a dictionary
-	Huffman::Tree::CharacterDictionary code_dictionary = input.huffman_tree.get_codes_for_decoding();
+uint64_t Huffman::decode(ByteSpan input, MutableByteSpan output, const DecodeOptions& options) {
+	auto pool = make_pool(options.threads);
+	ContainerReader reader(input);
+
+	std::optional<Tree> huffman_tree;
+	std::shared_ptr<const DecodeTable> table = dictionary_table(reader, options);
+
+	std::vector<std::shared_ptr<const DecodeTable>> tables(blocks_in_flight(options.threads));
+	std::vector<EncodedMessage::Block> blocks(tables.size());
+	std::vector<MessageView> messages(tables.size());
+	std::vector<uint64_t> offsets(tables.size());
+	std::vector<std::string> decoded_blocks(tables.size());
+
+	uint64_t output_size = 0;
+	bool finished = false;
+
+	while(!finished) {
+		size_t blocks_num = 0;
+		bool lengths_known = true;
+
+		for(; blocks_num < tables.size(); blocks_num++) {
+			if(!reader.read_block(huffman_tree, blocks[blocks_num], messages[blocks_num])) {
+				finished = true;
+				break;
+			}
 
-	// Decode the message
-	Buffer current;
+			if(huffman_tree) {
+				table = std::make_shared<const DecodeTable>(make_table(*huffman_tree, reader.is_canonical()));
+			}
 
-	for(auto it = input.message_buffer.bit_begin(); it != input.message_buffer.bit_end(); ++it) {
-		current <<= *it;
+			tables[blocks_num] = table;
+			lengths_known = lengths_known && blocks[blocks_num].length != EncodedMessage::Block::UNKNOWN_LENGTH;
+		}
+
+		// Blocks of older versions don't know their length, so they're decoded aside and copied
+		if(!lengths_known) {
+			for_each_index(pool.get(), blocks_num, [&](size_t i) {
+				HFF_PROFILE_PHASE(Phase::Decode, reader.get_blocks_read() - blocks_num + i);
+
+				decode_block(blocks[i], &messages[i], tables[i].get(), decoded_blocks[i]);
+			});
+
+			for(size_t i = 0; i < blocks_num; i++) {
+				if(decoded_blocks[i].size() > output.size() - output_size) {
+					throw OutputTooSmallException();
+				}
+
+				std::memcpy(output.data() + output_size, decoded_blocks[i].data(), decoded_blocks[i].size());
+				output_size += decoded_blocks[i].size();
+			}
+
+			continue;
+		}
+
+		// Otherwise every block is decoded straight into its place in the output
+		for(size_t i = 0; i < blocks_num; i++) {
+			check_block_length(blocks[i], messages[i]);
 
-		if(code_dictionary.find(current) != code_dictionary.end()) {
-			output << code_dictionary[current];
-			current = Buffer();
+			if(blocks[i].length > output.size() - output_size) {
+				throw OutputTooSmallException();
+			}
+
+			offsets[i] = output_size;
+			output_size += blocks[i].length;
 		}
+
+		for_each_index(pool.get(), blocks_num, [&](size_t i) {
+			HFF_PROFILE_PHASE(Phase::Decode, reader.get_blocks_read() - blocks_num + i);
+
+			decode_block(blocks[i], messages[i], tables[i].get(), output.subspan(offsets[i], blocks[i].length));
+		});
 	}
+
+	HFF_PROFILE_COUNT(Counter::BytesOut, output_size);
+
+	return output_size;
+}
+
+const char* Huffman::BlockTooLargeException::what() const noexcept {
+	return "The block is too large, its codes would be too long.";
 }
 
-const char* Huffman::OneCharacterSourceException::what() const noexcept {
-	return "Encoding single character sequences is currently unsupported.";
-}
\ No newline at end of file
+const char* Huffman::OutputTooSmallException::what() const noexcept {
+	return "The output is too small to hold the decoded message.";
+}
@@ -1,17 +1,153 @@
 #pragma once
 
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <stdexcept>
 #include <string>
 
+#include "dictionary/dictionary.hpp"
+#include "histogram/histogram.hpp"
 #include "message/message.hpp"
+#include "sink/sink.hpp"
+#include "span/span.hpp"
 
 namespace Huffman {
-	EncodedMessage encode(std::istream& input);
-	void decode(const EncodedMessage& input, std::ostream& output);
+	struct EncodeOptions {
+		/// @brief Use canonical codes, storing only the code lengths instead of the whole tree
+		bool canonical = false;
+		/// @brief How many bytes of the input are encoded in a single block, at most if blocks adapt to the input
+		size_t block_size = 1 << 20;
+		/// @brief Cut blocks further where the statistics of the input change, wherever a new block with its own tree pays off
+		/// The output is read like any other, only the single pass of `encode_stream` and dictionaries keep blocks of a fixed size
+		bool adaptive_blocks = true;
+		/// @brief How many threads encode the blocks, the output doesn't depend on it
+		size_t threads = 1;
+		/// @brief The longest code allowed, between 8 and `Tree::MAX_CODE_LENGTH`, zero for no limit
+		/// Codes no longer than `DecodeTable::MAX_LOOKUP_BITS` are always decoded with a single table lookup
+		uint8_t max_code_length = 0;
+		/// @brief How many streams every block is split into, so that the decoder can work on all of them at once
+		/// Between 1 and 255, a single stream keeps the block unsplit
+		size_t streams = 1;
+		/// @brief Store where the decoded content of every block ends in the footer, so that any range can be found without reading the blocks
+		bool seek_index = false;
+		/// @brief Follow every block with the CRC32C of its stored and of its decoded content, so that corruption is caught by `verify`
+		/// without decoding and by decoding itself
+		bool checksums = true;
+		/// @brief Up to how many order-1 tables a block may be encoded with, the character before every character picking its table
+		/// Between 2 and `ContextModel::MAX_TABLES`, zero encodes every character alike. Blocks get the tables only where they take fewer bytes
+		/// than with a tree, such blocks are never split into streams and decode a character per table lookup
+		size_t context_tables = 0;
+		/// @brief Encode every block with the codes of the dictionary, so that the message stores only its ID instead of trees
+		/// Pays off for small messages similar to the sample the dictionary was trained on
+		std::shared_ptr<const Dictionary> dictionary;
+	};
+
+	/// @brief Counters gathered while encoding
+	struct EncodeStats {
+		uint64_t input_size = 0;
+		uint64_t output_size = 0;
+		uint64_t blocks = 0;
+		/// @brief How many times a block was cut where the statistics of the input changed
+		uint64_t splits = 0;
+		/// @brief How many of the blocks are runs of a single character
+		uint64_t run_blocks = 0;
+		/// @brief How many trees were stored, blocks reusing the previous tree don't store one
+		uint64_t trees = 0;
+		/// @brief How many of the blocks are encoded with order-1 tables instead of a tree
+		uint64_t context_blocks = 0;
+		/// @brief How many bits longer the blocks get because of the code length limit, compared to their optimal codes
+		uint64_t length_limit_cost = 0;
+	};
+
+	/// @brief What was found checking a message with `verify`
+	struct VerifyStats {
+		uint64_t blocks = 0;
+		/// @brief Whether the message stores checksums, otherwise only the structure of its blocks and its footer were checked
+		bool checksums = false;
+	};
+
+	struct DecodeOptions {
+		/// @brief How many threads decode the blocks, the output doesn't depend on it
+		size_t threads = 1;
+		/// @brief The dictionary the message was encoded with, if any
+		std::shared_ptr<const Dictionary> dictionary;
+	};
+
+	/// @brief Builds a dictionary out of the character occurances of a sample of the messages it's meant for
+	/// Characters missing from the sample get codes too, so that the dictionary can encode any message
+	Dictionary train_dictionary(const Histogram& occurances);
+
+	/// @brief Encodes the input block by block, building a new tree for a block only where it pays off
+	/// Messages held this way store their trees, so the dictionary can't be used
+	EncodedMessage encode(std::istream& input, const EncodeOptions& options = EncodeOptions());
+
+	/// @brief Encodes the input block by block, writing every block to the output as soon as it's encoded
+	/// Memory use is bounded by the block size, no matter how large the input is
+	/// @param input The stream the message is read from, it's read only once
+	/// @param output The stream the serialized message is written to
+	void encode(std::istream& input, std::ostream& output, const EncodeOptions& options = EncodeOptions());
+
+	/// @brief Encodes the input like the overload above, gathering counters into `stats`
+	void encode(std::istream& input, std::ostream& output, const EncodeOptions& options, EncodeStats& stats);
+
+	/// @brief Encodes input held in memory, such as a mapped file, its blocks are encoded in place without copying them
+	/// @param output The sink the serialized message is passed to piece by piece, as soon as every block is encoded
+	void encode(ByteSpan input, OutputSink& output, const EncodeOptions& options = EncodeOptions());
+
+	/// @brief Encodes input held in memory like the overload above, gathering counters into `stats`
+	void encode(ByteSpan input, OutputSink& output, const EncodeOptions& options, EncodeStats& stats);
+
+	/// @brief Encodes the input in a single pass, passing every block on as soon as the input runs dry, so that slow inputs such as pipes
+	/// are encoded as they come with bounded latency and memory
+	/// The codes are built out of the input seen so far, rebuilt after ever larger stretches of it up to the block size, and every new
+	/// tree is stored in the first block encoded with it. Before the first rebuild the codes of the dictionary are used, or 8 bits for
+	/// every character without one. Canonical codes are always used, the seek index and threads aren't supported.
+	/// The codes lag behind the input, so block sizes smaller than the default adapt better, such as 64 KiB.
+	/// @param input The stream the message is read from, taking whatever it has at hand
+	/// @param output The sink the serialized message is passed to, flushed after every block
+	void encode_stream(std::istream& input, OutputSink& output, const EncodeOptions& options = EncodeOptions());
+
+	/// @brief Encodes the input in a single pass like the overload above, gathering counters into `stats`
+	void encode_stream(std::istream& input, OutputSink& output, const EncodeOptions& options, EncodeStats& stats);
+
+	void decode(const EncodedMessage& input, std::ostream& output, const DecodeOptions& options = DecodeOptions());
+
+	/// @brief Deserializes and decodes the message one block at a time
+	/// @param input The stream the serialized message is read from
+	/// @param output The stream the decoded message is written to
+	void decode(std::istream& input, std::ostream& output, const DecodeOptions& options = DecodeOptions());
+
+	/// @brief Deserializes and decodes a message held in memory, such as a mapped file, without copying its encoded blocks
+	void decode(ByteSpan input, std::ostream& output, const DecodeOptions& options = DecodeOptions());
+
+	/// @brief Works out how many bytes a message held in memory decodes to, reading only the headers of its blocks
+	/// Messages of versions which didn't store the length of every block have to be decoded to find out
+	uint64_t decoded_size(ByteSpan input);
+
+	/// @brief Decodes only the blocks of a message held in memory which cover the given range of its decoded content
+	/// Without a seek index the blocks are found through their headers, messages of versions which didn't store
+	/// the length of every block are decoded whole
+	/// @param offset Where the range starts in the decoded content
+	/// @param length How long the range is, it's cut short at the end of the decoded content
+	/// @param output The stream the range is written to
+	void decode_range(ByteSpan input, uint64_t offset, uint64_t length, std::ostream& output, const DecodeOptions& options = DecodeOptions());
+
+	/// @brief Checks every block of a message held in memory against its stored checksum, without decoding it
+	/// Throws `EncodedMessage::ChecksumMismatchException` for the first block which doesn't match
+	VerifyStats verify(ByteSpan input);
+
+	/// @brief Decodes a message held in memory straight into the output, every block going right into its place
+	/// @param output At least `decoded_size(input)` bytes long
+	/// @return How many bytes of the output were written
+	uint64_t decode(ByteSpan input, MutableByteSpan output, const DecodeOptions& options = DecodeOptions());
+
+	class BlockTooLargeException : public std::exception {
+	public:
+		const char* what() const noexcept override;
+	};
 
-	class OneCharacterSourceException : public std::exception {
+	class OutputTooSmallException : public std::exception {
 	public:
 		const char* what() const noexcept override;
 	};
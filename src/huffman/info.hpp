@@ -3,5 +3,5 @@
 #include <stdint.h>
 
 namespace Huffman {
-	const uint8_t CURRENT_VERSION = 0;
+	const uint8_t CURRENT_VERSION = 10;
 }
\ No newline at end of file
@@ -1,200 +1,66 @@
 #include "message.hpp"
 
+#include <algorithm>
+#include <optional>
 #include <string>
 #include <vector>
 
-#include "../info.hpp"
+#include "../container/container.hpp"
+#include "../dictionary/dictionary.hpp"
+#include "../sink/sink.hpp"
 
 void Huffman::EncodedMessage::serialize(std::ostream& output) const {
-	// Header section
-	output.write("HFF", 3);
-	uint8_t version_arr[1] = { Huffman::CURRENT_VERSION };
-	char* version_bytes = reinterpret_cast<char*>(version_arr);
-	output.write(version_bytes, 1);
-
-	// Content section
-	Buffer tree_buffer = huffman_tree.serialize();
-
-	Buffer content_buffer = tree_buffer;
-
-	content_buffer <<= message_buffer;
-
-	// This has to be done without reinterpret cast to not assume endianness
-	uint16_t tree_size = tree_buffer.get_length();
-	char tree_size_bytes[2] = {
-		static_cast<char>(tree_size),
-		static_cast<char>(tree_size >> 8),
-	};
-
-	output.write(tree_size_bytes, 2);
-
-	uint32_t message_size = message_buffer.get_length();
-	char message_size_bytes[4] = {
-		static_cast<char>(message_size),
-		static_cast<char>(message_size >> 8),
-		static_cast<char>(message_size >> 16),
-		static_cast<char>(message_size >> 24),
-	};
-
-	output.write(message_size_bytes, 4);
-
-	for(std::byte byte : content_buffer) {
-		char byte_char[1] = { std::to_integer<char>(byte) };
-		output.write(byte_char, 1);
+	// Checksums are stored only if every block knows the checksum of its decoded content, runs are checksummed as they're written
+	bool checksums = std::all_of(blocks.begin(), blocks.end(), [](const Block& block) {
+		return block.run || block.checksum.has_value();
+	});
+
+	StreamSink sink(output);
+	ContainerWriter writer(sink, canonical, false, std::nullopt, false, checksums);
+
+	// Consecutive blocks sharing a tree store it only once, runs in between don't need a tree
+	std::optional<size_t> last_tree_index;
+
+	for(const Block& block : blocks) {
+		if(block.run) {
+			writer.write_run(block.run_character, block.length);
+		} else if(block.contexts) {
+			writer.write_contexts_block(block);
+		} else if(last_tree_index == block.tree_index) {
+			writer.write_block(block);
+		} else {
+			writer.write_block(trees[block.tree_index], block);
+			last_tree_index = block.tree_index;
+		}
 	}
 
-	// Footer section
-	output.write("XX", 2);
-}
-
-void Huffman::EncodedMessage::ensure_stream_read_success(std::istream& stream) {
-	if(stream.eof()) {
-		throw UnexpectedEofException();
-	}
+	writer.finish();
 }
 
 Huffman::EncodedMessage Huffman::EncodedMessage::deserialize(std::istream& input) {
-	// Header section
-	char header_section[4];
-	input.read(header_section, 4);
-	ensure_stream_read_success(input);
-
-	std::string header = std::string() + header_section[0] + header_section[1] + header_section[2];
+	ContainerReader reader(input);
 
-	if(header != "HFF") {
-		throw InvalidHeaderException(header, "HFF");
+	// The trees of such messages live in the dictionary, which isn't part of the message
+	if(reader.get_dictionary_id()) {
+		throw MissingDictionaryException(*reader.get_dictionary_id());
 	}
 
-	if(header_section[3] != Huffman::CURRENT_VERSION) {
-		throw WrongVersionException(header_section[3], Huffman::CURRENT_VERSION);
-	}
+	EncodedMessage result;
+	result.canonical = reader.is_canonical();
 
-	// Content section
-	char tree_size_chars[2];
-	input.read(tree_size_chars, 2);
-	ensure_stream_read_success(input);
-	std::byte tree_size_bytes[2];
-	for(uint8_t i = 0; i < 4; i++) {
-		tree_size_bytes[i] = std::byte(tree_size_chars[i]);
-	}
-	uint16_t tree_size = std::to_integer<uint16_t>(tree_size_bytes[0]);
-	tree_size |= std::to_integer<uint16_t>(tree_size_bytes[1]) << 8;
-
-	char message_size_chars[4];
-	input.read(message_size_chars, 4);
-	ensure_stream_read_success(input);
-	std::byte message_size_bytes[4];
-	for(uint8_t i = 0; i < 4; i++) {
-		message_size_bytes[i] = std::byte(message_size_chars[i]);
-	}
-	uint32_t message_size = std::to_integer<uint32_t>(message_size_bytes[0]);
-	message_size |= std::to_integer<uint32_t>(message_size_bytes[1]) << 8;
-	message_size |= std::to_integer<uint32_t>(message_size_bytes[2]) << 16;
-	message_size |= std::to_integer<uint32_t>(message_size_bytes[3]) << 24;
-
-	uint64_t content_buffer_bits_num = tree_size + message_size;
-	uint8_t padding_size = content_buffer_bits_num % 8;
-	uint32_t content_buffer_bytes_num = content_buffer_bits_num / 8 + (padding_size > 0);
-
-	// Read the content bytes in 64 byte buffers
-	uint32_t bytes_left = content_buffer_bytes_num;
-	const uint32_t temp_buffer_size = 64;
-
-	Buffer tree_buffer, message_buffer;
-	tree_buffer.reserve_bytes(tree_size / 8 + (tree_size % 8 > 0));
-	message_buffer.reserve_bytes(message_size / 8 + (message_size % 8 > 0));
-
-	bool on_message = false;
-	uint64_t message_bits_read = 0;
-
-	while(bytes_left > 0) {
-		char content_bytes[temp_buffer_size];
-
-		uint32_t bytes_read_this_iteration = bytes_left > temp_buffer_size ? temp_buffer_size : bytes_left;
-
-		input.read(content_bytes, bytes_read_this_iteration);
-		ensure_stream_read_success(input);
-
-		bytes_left -= bytes_read_this_iteration;
-		uint32_t bytes_read = content_buffer_bytes_num - bytes_left;
-
-		if(bytes_read < tree_size / 8) {
-			// Add the bytes to the tree buffer
-			for(uint32_t i = 0; i < bytes_read_this_iteration; i++) {
-				tree_buffer <<= std::byte(content_bytes[i]);
-			}
-		} else if(!on_message) {
-			uint32_t byte_index = 0;
-
-			// First, go over the bytes that contain only the tree information
-			for(; byte_index < bytes_read_this_iteration - (bytes_read - tree_size / 8); byte_index++) {
-				tree_buffer <<= std::byte(content_bytes[byte_index]);
-			}
-
-			// Divide the common byte between the two buffers
-			uint8_t bit_index = 0;
-
-			// The byte that contains both tree and message information
-			std::byte common_byte = std::byte(content_bytes[byte_index]);
-
-			for(; bit_index < tree_size % 8; bit_index++) {
-				tree_buffer <<= static_cast<bool>((common_byte >> (7 - bit_index)) & std::byte(1));
-			}
-
-			for(; bit_index < 8 && message_size - message_bits_read > 0; bit_index++) {
-				message_buffer <<= static_cast<bool>((common_byte >> (7 - bit_index)) & std::byte(1));
-				message_bits_read++;
-			}
-
-			byte_index++;
-
-			// Add the rest of the bytes to the message buffer
-			for(; byte_index < bytes_read_this_iteration && message_size - message_bits_read >= 8; byte_index++) {
-				message_buffer <<= std::byte(content_bytes[byte_index]);
-				message_bits_read += 8;
-			}
-
-			// Add bits without padding
-			if(message_bits_read != message_size && message_size - message_bits_read < 8) {
-				for(uint8_t i = 0; i < message_size - message_bits_read; i++) {
-					message_buffer <<= static_cast<bool>(content_bytes[bytes_read_this_iteration - 1] & (1 << (7 - i)));
-				}
-			}
-
-			// On the next iterations, simply add the bytes to the message buffer
-			on_message = true;
-		} else {
-			// Add the bytes to the message buffer
-			for(uint32_t i = 0; i < bytes_read_this_iteration && message_size - message_bits_read >= 8; i++) {
-				message_buffer <<= std::byte(content_bytes[i]);
-				message_bits_read += 8;
-			}
-
-			// Add bits without padding
-			if(message_bits_read != message_size && message_size - message_bits_read < 8) {
-				for(uint8_t i = 0; i < message_size - message_bits_read; i++) {
-					message_buffer <<= static_cast<bool>(content_bytes[bytes_read_this_iteration - 1] & (1 << (7 - i)));
-				}
-			}
-		}
-	}
-
-	try {
-		Tree tree = Tree::deserialize(tree_buffer);
+	std::optional<Tree> huffman_tree;
+	Block block;
 
-		// Footer section
-		char footer_bytes[2];
-		input.read(footer_bytes, 2);
-		ensure_stream_read_success(input);
-
-		if(footer_bytes[0] != 'X' || footer_bytes[1] != 'X') {
-			throw InvalidFooterException(std::string() + footer_bytes[0] + footer_bytes[1], "XX");
+	while(reader.read_block(huffman_tree, block)) {
+		if(huffman_tree) {
+			result.trees.push_back(std::move(*huffman_tree));
 		}
 
-		return { std::move(tree), message_buffer };
-	} catch(const Tree::DeserializationException& e) {
-		throw InvalidTreeDataException();
+		block.tree_index = result.trees.size() - 1;
+		result.blocks.push_back(std::move(block));
 	}
+
+	return result;
 }
 
 Huffman::EncodedMessage::DeserializationException::DeserializationException() {}
@@ -241,6 +107,53 @@ Huffman::EncodedMessage::InvalidTreeDataException::InvalidTreeDataException() {
 	m_Message = "Serialized tree data is invalid.";
 }
 
+Huffman::EncodedMessage::InvalidBlockIndexException::InvalidBlockIndexException() {
+	m_Message = "The block index doesn't match the blocks.";
+}
+
+Huffman::EncodedMessage::InvalidBlockLengthException::InvalidBlockLengthException() {
+	m_Message = "A block doesn't decode to its stored length.";
+}
+
+Huffman::EncodedMessage::ChecksumMismatchException::ChecksumMismatchException() {
+	m_Message = "A block doesn't decode to the content it was encoded from.";
+}
+
+Huffman::EncodedMessage::ChecksumMismatchException::ChecksumMismatchException(uint64_t block) {
+	m_Block = block;
+
+	m_Message = "The block " + std::to_string(block) + " doesn't match its checksum.";
+}
+
+std::optional<uint64_t> Huffman::EncodedMessage::ChecksumMismatchException::get_block() const {
+	return m_Block;
+}
+
+Huffman::EncodedMessage::MissingDictionaryException::MissingDictionaryException(uint32_t dictionary_id) {
+	m_DictionaryId = dictionary_id;
+
+	m_Message = "The message was encoded with the dictionary " + Dictionary::format_id(dictionary_id) + ", which wasn't given.";
+}
+
+uint32_t Huffman::EncodedMessage::MissingDictionaryException::get_dictionary_id() const {
+	return m_DictionaryId;
+}
+
+Huffman::EncodedMessage::WrongDictionaryException::WrongDictionaryException(uint32_t file_dictionary_id, uint32_t given_dictionary_id) {
+	m_FileDictionaryId = file_dictionary_id;
+	m_GivenDictionaryId = given_dictionary_id;
+
+	m_Message = "Wrong dictionary. Expected " + Dictionary::format_id(file_dictionary_id) + ", got " + Dictionary::format_id(given_dictionary_id) + ".";
+}
+
+uint32_t Huffman::EncodedMessage::WrongDictionaryException::get_file_dictionary_id() const {
+	return m_FileDictionaryId;
+}
+
+uint32_t Huffman::EncodedMessage::WrongDictionaryException::get_given_dictionary_id() const {
+	return m_GivenDictionaryId;
+}
+
 Huffman::EncodedMessage::InvalidFooterException::InvalidFooterException(std::string file_footer, std::string expected_footer) {
 	m_FileFooter = file_footer;
 	m_ExpectedFooter = expected_footer;
@@ -2,27 +2,50 @@
 
 #include "../tree/tree.hpp"
 #include "../buffer/buffer.hpp"
+#include "../context/context.hpp"
 
+#include <cstdint>
 #include <istream>
+#include <memory>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <vector>
 
 namespace Huffman {
 	struct EncodedMessage {
-		Tree huffman_tree;
-		Buffer message_buffer;
+		struct Block {
+			/// @brief Marks the length of blocks of versions which didn't store it
+			static constexpr uint64_t UNKNOWN_LENGTH = UINT64_MAX;
+
+			/// @brief Index of the tree in `trees` which the block is encoded with, unused by runs
+			size_t tree_index;
+			Buffer message_buffer;
+			/// @brief The length of every stream in bits if the block is split into multiple streams, empty otherwise
+			/// The streams encode consecutive segments of the block and start at byte boundaries of `message_buffer`
+			std::vector<uint64_t> stream_lengths;
+			/// @brief How many characters the block decodes to
+			uint64_t length = UNKNOWN_LENGTH;
+			/// @brief Whether the block is `run_character` repeated `length` times, stored without a tree or an encoded message
+			bool run = false;
+			uint8_t run_character = 0;
+			/// @brief The order-1 tables the block is encoded with, stored with the block itself, null for blocks encoded with a tree
+			/// Such blocks are never split into streams and don't affect which tree the blocks after them reuse
+			std::shared_ptr<const ContextModel> contexts;
+			/// @brief The CRC32C of the decoded content of the block, checked once it's decoded, if the message stores it
+			std::optional<uint32_t> checksum;
+		};
+
+		/// @brief Trees used by the blocks, consecutive blocks may share a tree
+		std::vector<Tree> trees;
+		std::vector<Block> blocks;
+		/// @brief Whether the trees hold canonical codes, in which case only their code lengths are serialized
+		bool canonical = false;
 
 		void serialize(std::ostream& output) const;
 		static EncodedMessage deserialize(std::istream& input);
 
-	private:
-		/// @brief A helper function for the `deserialize` method
-		/// @param stream The input stream (usually a file)
-		static void ensure_stream_read_success(std::istream& stream);
-
 	public:
-
 		class DeserializationException : public std::exception {
 		protected:
 			std::string m_Message;
@@ -65,6 +88,48 @@ namespace Huffman {
 			InvalidTreeDataException();
 		};
 
+		class InvalidBlockIndexException : public DeserializationException {
+		public:
+			InvalidBlockIndexException();
+		};
+
+		class InvalidBlockLengthException : public DeserializationException {
+		public:
+			InvalidBlockLengthException();
+		};
+
+		class ChecksumMismatchException : public DeserializationException {
+			std::optional<uint64_t> m_Block;
+
+		public:
+			/// @brief A block whose decoded content doesn't match its checksum
+			ChecksumMismatchException();
+			/// @brief The block of the given index, counted from the first one, whose stored content doesn't match its checksum
+			explicit ChecksumMismatchException(uint64_t block);
+
+			std::optional<uint64_t> get_block() const;
+		};
+
+		class MissingDictionaryException : public DeserializationException {
+			uint32_t m_DictionaryId;
+
+		public:
+			explicit MissingDictionaryException(uint32_t dictionary_id);
+
+			uint32_t get_dictionary_id() const;
+		};
+
+		class WrongDictionaryException : public DeserializationException {
+			uint32_t m_FileDictionaryId;
+			uint32_t m_GivenDictionaryId;
+
+		public:
+			WrongDictionaryException(uint32_t file_dictionary_id, uint32_t given_dictionary_id);
+
+			uint32_t get_file_dictionary_id() const;
+			uint32_t get_given_dictionary_id() const;
+		};
+
 		class InvalidFooterException : public DeserializationException {
 			std::string m_FileFooter;
 			std::string m_ExpectedFooter;
@@ -0,0 +1,121 @@
+#include "pool.hpp"
+
+#include <system_error>
+#include <utility>
+
+namespace {
+	// Lets tasks submitted by a worker go straight to its own queue
+	thread_local const Huffman::ThreadPool* current_pool = nullptr;
+	thread_local size_t current_queue_index = 0;
+}
+
+Huffman::ThreadPool::ThreadPool(size_t threads_num)
+	: m_Pending(0), m_Stopping(false), m_NextQueue(0) {
+	if(threads_num == 0) {
+		threads_num = 1;
+	}
+
+	for(size_t i = 0; i < threads_num; i++) {
+		m_Queues.push_back(std::make_unique<Queue>());
+	}
+
+	// The system may run out of threads before as many start as asked for, the ones that did start steal the tasks of the others
+	for(size_t i = 0; i < threads_num; i++) {
+		try {
+			m_Threads.emplace_back(&ThreadPool::work, this, i);
+		} catch(const std::system_error&) {
+			if(m_Threads.empty()) {
+				throw;
+			}
+
+			break;
+		}
+	}
+}
+
+Huffman::ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_Condition.notify_all();
+
+	for(std::thread& thread : m_Threads) {
+		thread.join();
+	}
+}
+
+size_t Huffman::ThreadPool::get_threads_num() const {
+	return m_Threads.size();
+}
+
+void Huffman::ThreadPool::push(Task task) {
+	size_t queue_index = current_pool == this
+		? current_queue_index
+		: m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+
+	// Counted before it's queued, so that a worker taking it right away can't count it off first
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Pending++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Queues[queue_index]->mutex);
+		m_Queues[queue_index]->tasks.push_back(std::move(task));
+	}
+
+	m_Condition.notify_one();
+}
+
+bool Huffman::ThreadPool::pop(size_t queue_index, Task& task) {
+	// The own queue is used from the front, the others are stolen from at the back
+	for(size_t i = 0; i < m_Queues.size(); i++) {
+		Queue& queue = *m_Queues[(queue_index + i) % m_Queues.size()];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if(queue.tasks.empty()) {
+			continue;
+		}
+
+		if(i == 0) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		} else {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void Huffman::ThreadPool::work(size_t queue_index) {
+	current_pool = this;
+	current_queue_index = queue_index;
+
+	while(true) {
+		Task task;
+
+		if(pop(queue_index, task)) {
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Pending--;
+			}
+
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Condition.wait(lock, [this]() { return m_Stopping || m_Pending > 0; });
+
+		if(m_Stopping && m_Pending == 0) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Huffman {
+	/// @brief A thread pool in which every worker has its own task queue and steals from the others when it runs out
+	class ThreadPool {
+		using Task = std::function<void()>;
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_Queues;
+		std::vector<std::thread> m_Threads;
+
+		/// @brief Guards `m_Pending` and `m_Stopping`, idle workers sleep on `m_Condition`
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		size_t m_Pending;
+		bool m_Stopping;
+
+		/// @brief The queue tasks submitted from outside of the pool go to, assigned round-robin
+		std::atomic<size_t> m_NextQueue;
+
+	public:
+		explicit ThreadPool(size_t threads_num);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t get_threads_num() const;
+
+		/// @brief Schedules the function to be run by one of the workers
+		/// @return A future holding the result of the function, or the exception it threw
+		template <typename Function>
+		std::future<std::invoke_result_t<Function>> submit(Function function) {
+			auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+			auto result = task->get_future();
+
+			push([task]() { (*task)(); });
+
+			return result;
+		}
+
+	private:
+		void push(Task task);
+
+		// Takes a task from the worker's own queue, or steals one from the other queues
+		bool pop(size_t queue_index, Task& task);
+
+		void work(size_t queue_index);
+	};
+};
@@ -0,0 +1,369 @@
+#include "profile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	struct Event {
+		Huffman::Phase phase;
+		int64_t block;
+		uint32_t thread;
+		Clock::time_point begin;
+		Clock::time_point end;
+	};
+
+	// Everything is kept in one place constructed on first use, as allocations are counted from before main
+	struct State {
+		std::atomic<bool> enabled{ false };
+		std::atomic<bool> trace{ false };
+		std::array<std::atomic<uint64_t>, Huffman::Profiler::PHASES_NUM> phase_nanoseconds{};
+		std::array<std::atomic<uint64_t>, Huffman::Profiler::PHASES_NUM> phase_calls{};
+		std::array<std::atomic<uint64_t>, Huffman::Profiler::COUNTERS_NUM> counters{};
+		std::atomic<uint32_t> threads_num{ 0 };
+
+		Clock::time_point start;
+		std::mutex events_mutex;
+		std::vector<Event> events;
+	};
+
+	State& state() {
+		static State result;
+
+		return result;
+	}
+
+	// Threads are numbered in the order they first record something
+	uint32_t thread_index() {
+		thread_local uint32_t result = state().threads_num++;
+
+		return result;
+	}
+
+	// The innermost phase timed on this thread
+	thread_local Huffman::ScopedPhase* current_phase = nullptr;
+
+	double nanoseconds_to_milliseconds(uint64_t nanoseconds) {
+		return nanoseconds / 1e6;
+	}
+}
+
+void Huffman::Profiler::enable(bool trace) {
+	State& profiler_state = state();
+
+	profiler_state.start = Clock::now();
+	profiler_state.trace = trace;
+	profiler_state.enabled = true;
+}
+
+bool Huffman::Profiler::is_enabled() {
+	return state().enabled.load(std::memory_order_relaxed);
+}
+
+void Huffman::Profiler::add_phase(Phase phase, uint64_t self_nanoseconds) {
+	State& profiler_state = state();
+
+	profiler_state.phase_nanoseconds[static_cast<size_t>(phase)].fetch_add(self_nanoseconds, std::memory_order_relaxed);
+	profiler_state.phase_calls[static_cast<size_t>(phase)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Huffman::Profiler::add_counter(Counter counter, uint64_t value) {
+	state().counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Huffman::Profiler::add_event(Phase phase, int64_t block, Clock::time_point begin, Clock::time_point end) {
+	State& profiler_state = state();
+
+	if(!profiler_state.trace.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	uint32_t thread = thread_index();
+
+	std::lock_guard<std::mutex> lock(profiler_state.events_mutex);
+	profiler_state.events.push_back({ phase, block, thread, begin, end });
+}
+
+Huffman::Profiler::Report Huffman::Profiler::get_report() {
+	State& profiler_state = state();
+	Report result;
+
+	for(size_t i = 0; i < PHASES_NUM; i++) {
+		result.phases[i].nanoseconds = profiler_state.phase_nanoseconds[i];
+		result.phases[i].calls = profiler_state.phase_calls[i];
+	}
+
+	for(size_t i = 0; i < COUNTERS_NUM; i++) {
+		result.counters[i] = profiler_state.counters[i];
+	}
+
+	return result;
+}
+
+std::string Huffman::Profiler::phase_name(Phase phase) {
+	switch(phase) {
+	case Phase::Read:
+		return "read";
+
+	case Phase::Histogram:
+		return "histogram";
+
+	case Phase::TreeBuild:
+		return "tree_build";
+
+	case Phase::CodeGeneration:
+		return "code_generation";
+
+	case Phase::BitPacking:
+		return "bit_packing";
+
+	case Phase::Serialize:
+		return "serialize";
+
+	case Phase::Deserialize:
+		return "deserialize";
+
+	case Phase::TableBuild:
+		return "table_build";
+
+	case Phase::Decode:
+		return "decode";
+
+	case Phase::Write:
+		return "write";
+	}
+
+	return "unknown";
+}
+
+std::string Huffman::Profiler::counter_name(Counter counter) {
+	switch(counter) {
+	case Counter::BytesIn:
+		return "bytes_in";
+
+	case Counter::BytesOut:
+		return "bytes_out";
+
+	case Counter::Blocks:
+		return "blocks";
+
+	case Counter::Symbols:
+		return "symbols";
+
+	case Counter::EncodedBits:
+		return "encoded_bits";
+
+	case Counter::EntropyBits:
+		return "entropy_bits";
+
+	case Counter::Allocations:
+		return "allocations";
+
+	case Counter::AllocatedBytes:
+		return "allocated_bytes";
+	}
+
+	return "unknown";
+}
+
+void Huffman::Profiler::write_report(std::ostream& output) {
+	Report report = get_report();
+
+	uint64_t total_nanoseconds = 0;
+
+	for(const PhaseTotal& phase : report.phases) {
+		total_nanoseconds += phase.nanoseconds;
+	}
+
+	output << std::fixed << std::setprecision(2) << "Phases:\n";
+
+	for(size_t i = 0; i < PHASES_NUM; i++) {
+		if(report.phases[i].calls == 0) {
+			continue;
+		}
+
+		output << "  " << std::left << std::setw(16) << phase_name(static_cast<Phase>(i)) << std::right
+			<< std::setw(10) << nanoseconds_to_milliseconds(report.phases[i].nanoseconds) << " ms "
+			<< std::setw(6) << 100.0 * report.phases[i].nanoseconds / std::max<uint64_t>(total_nanoseconds, 1) << "% "
+			<< "(" << report.phases[i].calls << " calls)\n";
+	}
+
+	output << "Counters:\n";
+
+	for(size_t i = 0; i < COUNTERS_NUM; i++) {
+		output << "  " << std::left << std::setw(16) << counter_name(static_cast<Counter>(i)) << std::right << report.counters[i] << "\n";
+	}
+
+	uint64_t symbols = report.counters[static_cast<size_t>(Counter::Symbols)];
+
+	if(symbols > 0) {
+		output << std::setprecision(3)
+			<< "Average code length: " << static_cast<double>(report.counters[static_cast<size_t>(Counter::EncodedBits)]) / symbols << " bits\n";
+	}
+
+	if(symbols > 0 && report.counters[static_cast<size_t>(Counter::EntropyBits)] > 0) {
+		output << std::setprecision(3)
+			<< "Entropy:             " << static_cast<double>(report.counters[static_cast<size_t>(Counter::EntropyBits)]) / symbols << " bits\n";
+	}
+}
+
+void Huffman::Profiler::write_json_report(std::ostream& output) {
+	Report report = get_report();
+
+	output << std::fixed << std::setprecision(6) << "{\"phases\":{";
+
+	for(size_t i = 0; i < PHASES_NUM; i++) {
+		output << (i > 0 ? "," : "") << "\"" << phase_name(static_cast<Phase>(i)) << "\":{\"seconds\":"
+			<< report.phases[i].nanoseconds / 1e9 << ",\"calls\":" << report.phases[i].calls << "}";
+	}
+
+	output << "},\"counters\":{";
+
+	for(size_t i = 0; i < COUNTERS_NUM; i++) {
+		output << (i > 0 ? "," : "") << "\"" << counter_name(static_cast<Counter>(i)) << "\":" << report.counters[i];
+	}
+
+	uint64_t symbols = std::max<uint64_t>(report.counters[static_cast<size_t>(Counter::Symbols)], 1);
+
+	output << "},\"bits_per_symbol\":" << static_cast<double>(report.counters[static_cast<size_t>(Counter::EncodedBits)]) / symbols
+		<< ",\"entropy_bits_per_symbol\":" << static_cast<double>(report.counters[static_cast<size_t>(Counter::EntropyBits)]) / symbols
+		<< "}\n";
+}
+
+void Huffman::Profiler::write_trace(std::ostream& output) {
+	State& profiler_state = state();
+	std::lock_guard<std::mutex> lock(profiler_state.events_mutex);
+
+	auto microseconds = [&profiler_state](Clock::time_point time) {
+		return std::chrono::duration<double, std::micro>(time - profiler_state.start).count();
+	};
+
+	output << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for(uint32_t i = 0; i < profiler_state.threads_num; i++) {
+		output << (i > 0 ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << (i == 0 ? "main" : "worker " + std::to_string(i)) << "\"}}";
+	}
+
+	for(size_t i = 0; i < profiler_state.events.size(); i++) {
+		const Event& event = profiler_state.events[i];
+
+		output << (i > 0 || profiler_state.threads_num > 0 ? "," : "") << "\n{\"name\":\"" << phase_name(event.phase)
+			<< "\",\"cat\":\"hff\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+			<< ",\"ts\":" << microseconds(event.begin) << ",\"dur\":" << microseconds(event.end) - microseconds(event.begin);
+
+		if(event.block >= 0) {
+			output << ",\"args\":{\"block\":" << event.block << "}";
+		}
+
+		output << "}";
+	}
+
+	output << "\n]}\n";
+}
+
+Huffman::ScopedPhase::ScopedPhase(Phase phase, int64_t block)
+	: m_Phase(phase), m_Block(block), m_Enabled(Profiler::is_enabled()), m_NestedNanoseconds(0), m_Parent(nullptr) {
+	if(!m_Enabled) {
+		return;
+	}
+
+	// The thread is numbered before the phase starts, so that the main thread comes first
+	thread_index();
+
+	m_Parent = current_phase;
+	current_phase = this;
+	m_Begin = Clock::now();
+}
+
+Huffman::ScopedPhase::~ScopedPhase() {
+	if(!m_Enabled) {
+		return;
+	}
+
+	Clock::time_point end = Clock::now();
+	uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_Begin).count();
+
+	Profiler::add_phase(m_Phase, nanoseconds - std::min(nanoseconds, m_NestedNanoseconds));
+	Profiler::add_event(m_Phase, m_Block, m_Begin, end);
+
+	current_phase = m_Parent;
+
+	if(m_Parent != nullptr) {
+		m_Parent->m_NestedNanoseconds += nanoseconds;
+	}
+}
+
+#ifdef HFF_PROFILE
+// Every allocation of the program is counted while profiling
+void* operator new(std::size_t size) {
+	if(Huffman::Profiler::is_enabled()) {
+		Huffman::Profiler::add_counter(Huffman::Counter::Allocations, 1);
+		Huffman::Profiler::add_counter(Huffman::Counter::AllocatedBytes, size);
+	}
+
+	while(true) {
+		void* result = std::malloc(size == 0 ? 1 : size);
+
+		if(result != nullptr) {
+			return result;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+
+		if(handler == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		handler();
+	}
+}
+
+// The other forms are replaced as well, so that every allocation is freed the way it was made
+void* operator new[](std::size_t size) {
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return ::operator new(size);
+	} catch(const std::bad_alloc& e) {
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	std::free(pointer);
+}
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace Huffman {
+	/// @brief The phases the time of encoding and decoding is split into
+	enum class Phase {
+		/// @brief Reading the input to be encoded
+		Read,
+		Histogram,
+		TreeBuild,
+		/// @brief Choosing the codes of every block and building their tables
+		CodeGeneration,
+		BitPacking,
+		/// @brief Writing the blocks into the container
+		Serialize,
+		/// @brief Reading the blocks out of the container
+		Deserialize,
+		/// @brief Building the decode tables
+		TableBuild,
+		Decode,
+		/// @brief Writing the output, encoded or decoded
+		Write
+	};
+
+	enum class Counter {
+		BytesIn,
+		BytesOut,
+		Blocks,
+		/// @brief How many characters were encoded or decoded
+		Symbols,
+		/// @brief How many bits the encoded characters took
+		EncodedBits,
+		/// @brief How many bits the encoded characters would take with an ideal order-0 coder for every block
+		EntropyBits,
+		Allocations,
+		AllocatedBytes
+	};
+
+	/// @brief Gathers the time spent in every phase and the counters, once it's enabled
+	/// Only builds with `HFF_PROFILE` defined are instrumented, the `HFF_PROFILE_*` macros compile to nothing otherwise
+	class Profiler {
+	public:
+		static constexpr size_t PHASES_NUM = static_cast<size_t>(Phase::Write) + 1;
+		static constexpr size_t COUNTERS_NUM = static_cast<size_t>(Counter::AllocatedBytes) + 1;
+
+		struct PhaseTotal {
+			/// @brief Time spent in the phase itself, excluding the phases nested in it
+			uint64_t nanoseconds = 0;
+			uint64_t calls = 0;
+		};
+
+		struct Report {
+			std::array<PhaseTotal, PHASES_NUM> phases;
+			std::array<uint64_t, COUNTERS_NUM> counters;
+		};
+
+		/// @brief Whether the build is instrumented at all
+		static constexpr bool is_compiled() {
+#ifdef HFF_PROFILE
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		/// @brief Starts gathering, with every phase of every block also recorded as an event for the trace if `trace` is set
+		static void enable(bool trace);
+		static bool is_enabled();
+
+		static void add_phase(Phase phase, uint64_t self_nanoseconds);
+		static void add_counter(Counter counter, uint64_t value);
+		/// @brief Records a phase as an event of the trace, if it's enabled
+		static void add_event(Phase phase, int64_t block, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+		static Report get_report();
+
+		static std::string phase_name(Phase phase);
+		static std::string counter_name(Counter counter);
+
+		/// @brief Writes the report in a form meant for people
+		static void write_report(std::ostream& output);
+		/// @brief Writes the report as a JSON object
+		static void write_json_report(std::ostream& output);
+		/// @brief Writes the recorded events in the Chrome trace event format, one timeline per thread
+		static void write_trace(std::ostream& output);
+	};
+
+	/// @brief Times a phase for as long as it exists, phases nested in it on the same thread are subtracted from it
+	class ScopedPhase {
+		Phase m_Phase;
+		int64_t m_Block;
+		bool m_Enabled;
+		std::chrono::steady_clock::time_point m_Begin;
+		uint64_t m_NestedNanoseconds;
+		ScopedPhase* m_Parent;
+
+	public:
+		/// @param block The index of the block the phase works on, negative if it isn't about a single block
+		explicit ScopedPhase(Phase phase, int64_t block = -1);
+		~ScopedPhase();
+
+		ScopedPhase(const ScopedPhase&) = delete;
+		ScopedPhase& operator=(const ScopedPhase&) = delete;
+	};
+};
+
+#ifdef HFF_PROFILE
+#define HFF_PROFILE_CONCAT_INNER(left, right) left##right
+#define HFF_PROFILE_CONCAT(left, right) HFF_PROFILE_CONCAT_INNER(left, right)
+#define HFF_PROFILE_PHASE(...) Huffman::ScopedPhase HFF_PROFILE_CONCAT(hff_profile_phase_, __LINE__)(__VA_ARGS__)
+#define HFF_PROFILE_COUNT(counter, value) \
+	do { \
+		if(Huffman::Profiler::is_enabled()) { \
+			Huffman::Profiler::add_counter(counter, value); \
+		} \
+	} while(false)
+#else
+#define HFF_PROFILE_PHASE(...) ((void)0)
+#define HFF_PROFILE_COUNT(counter, value) ((void)0)
+#endif
@@ -0,0 +1,23 @@
+#include "sink.hpp"
+
+#include "../profile/profile.hpp"
+
+Huffman::StreamSink::StreamSink(std::ostream& output)
+	: m_Output(output) {}
+
+void Huffman::StreamSink::write(ByteSpan bytes) {
+	HFF_PROFILE_PHASE(Phase::Write);
+
+	m_Output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void Huffman::StreamSink::flush() {
+	m_Output.flush();
+}
+
+Huffman::VectorSink::VectorSink(std::vector<std::byte>& output)
+	: m_Output(output) {}
+
+void Huffman::VectorSink::write(ByteSpan bytes) {
+	m_Output.insert(m_Output.end(), bytes.begin(), bytes.end());
+}
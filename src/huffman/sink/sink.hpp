@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../span/span.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace Huffman {
+	/// @brief Takes the serialized output, so that it can go anywhere without wrapping it in an iostream
+	class OutputSink {
+	public:
+		virtual ~OutputSink() = default;
+
+		/// @brief Takes the bytes, which are only valid during the call
+		virtual void write(ByteSpan bytes) = 0;
+
+		/// @brief Passes on everything written so far, for sinks which hold the output back
+		virtual void flush() {}
+	};
+
+	/// @brief Writes the output to a stream
+	class StreamSink : public OutputSink {
+		std::ostream& m_Output;
+
+	public:
+		explicit StreamSink(std::ostream& output);
+
+		void write(ByteSpan bytes) override;
+		void flush() override;
+	};
+
+	/// @brief Appends the output to a vector
+	class VectorSink : public OutputSink {
+		std::vector<std::byte>& m_Output;
+
+	public:
+		explicit VectorSink(std::vector<std::byte>& output);
+
+		void write(ByteSpan bytes) override;
+	};
+};
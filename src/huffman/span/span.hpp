@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Huffman {
+	/// @brief A view of contiguous elements owned by someone else, standing in for `std::span` which needs C++20
+	template <typename T>
+	class Span {
+		T* m_Data;
+		size_t m_Size;
+
+	public:
+		constexpr Span()
+			: m_Data(nullptr), m_Size(0) {}
+
+		constexpr Span(T* data, size_t size)
+			: m_Data(data), m_Size(size) {}
+
+		/// @brief Views of mutable elements can be passed where read-only views are expected
+		constexpr operator Span<const T>() const {
+			return Span<const T>(m_Data, m_Size);
+		}
+
+		constexpr T* data() const {
+			return m_Data;
+		}
+
+		constexpr size_t size() const {
+			return m_Size;
+		}
+
+		constexpr bool empty() const {
+			return m_Size == 0;
+		}
+
+		constexpr T& operator[](size_t index) const {
+			return m_Data[index];
+		}
+
+		constexpr T* begin() const {
+			return m_Data;
+		}
+
+		constexpr T* end() const {
+			return m_Data + m_Size;
+		}
+
+		/// @brief A view of `count` elements starting at `offset`, both of which have to lie within the view
+		constexpr Span subspan(size_t offset, size_t count) const {
+			return Span(m_Data + offset, count);
+		}
+	};
+
+	using ByteSpan = Span<const std::byte>;
+	using MutableByteSpan = Span<std::byte>;
+};
@@ -1,166 +1,373 @@
 #include "tree.hpp"
 
+#include "../bitstream/bitstream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
 
-// Node methods definitions
-Huffman::Tree::Node::Node(uint8_t character, uint64_t occurances)
-	: m_Character(character), m_Occurences(occurances) {}
+namespace {
+	// Path bits leading to a node, one per level
+	using Path = std::array<bool, Huffman::Tree::MAX_NODES / 2 + 1>;
 
-void Huffman::Tree::Node::push_left(std::unique_ptr<Huffman::Tree::Node>&& node) {
-	m_Left = std::move(node);
-}
+	Huffman::Tree::Code make_code(const Path& path, uint16_t depth) {
+		Huffman::Tree::Code code;
 
-void Huffman::Tree::Node::push_right(std::unique_ptr<Huffman::Tree::Node>&& node) {
-	m_Right = std::move(node);
-}
+		for(uint16_t i = 0; i < depth; i++) {
+			code <<= path[i];
+		}
 
-uint8_t Huffman::Tree::Node::get_character() const {
-	return m_Character;
+		return code;
+	}
 }
 
-uint64_t Huffman::Tree::Node::get_occurances() const {
-	return m_Occurences;
-}
+Huffman::Tree::Tree()
+	: m_NodesNum(0), m_Root(NO_NODE) {}
 
-const std::unique_ptr<Huffman::Tree::Node>& Huffman::Tree::Node::get_left() const {
-	return m_Left;
+Huffman::Tree::Tree(uint8_t character, uint64_t occurences)
+	: Tree() {
+	add_leaf(character, occurences);
 }
 
-const std::unique_ptr<Huffman::Tree::Node>& Huffman::Tree::Node::get_right() const {
-	return m_Right;
+uint16_t Huffman::Tree::add_node(bool leaf, uint8_t character, uint64_t occurances) {
+	if(m_NodesNum == MAX_NODES) {
+		throw std::length_error("A Huffman tree can't have more nodes than a tree of 256 characters.");
+	}
+
+	m_Nodes[m_NodesNum] = { occurances, NO_NODE, NO_NODE, character, leaf };
+
+	return m_NodesNum++;
 }
 
-// Tree methods definitions
-Huffman::Tree::Tree(uint8_t character, uint64_t occurences) {
-	m_Root = std::make_unique<Node>(character, occurences);
+uint16_t Huffman::Tree::add_leaf(uint8_t character, uint64_t occurences) {
+	m_Root = add_node(true, character, occurences);
+
+	return m_Root;
 }
 
-Huffman::Tree::Tree(Tree&& left_tree, Tree&& right_tree) {
-	// Using the null character for parent nodes
-	m_Root = std::make_unique<Node>('\0', left_tree.get_occurances() + right_tree.get_occurances());
-	m_Root->push_left(std::move(left_tree.m_Root));
-	m_Root->push_right(std::move(right_tree.m_Root));
+uint16_t Huffman::Tree::add_parent(uint16_t left, uint16_t right) {
+	uint16_t parent = add_node(false, 0, m_Nodes[left].occurances + m_Nodes[right].occurances);
+
+	m_Nodes[parent].left = left;
+	m_Nodes[parent].right = right;
+	m_Root = parent;
+
+	return parent;
 }
 
 uint64_t Huffman::Tree::get_occurances() const {
-	return m_Root->get_occurances();
+	return m_Nodes[m_Root].occurances;
 }
 
-void Huffman::Tree::generate_codes(CodeDictionary& code_dict, const std::unique_ptr<Node>& current_node, Code current_code) const {
-	if(current_node->get_character() != '\0') {
-		code_dict[current_node->get_character()] = current_code;
-		return;
-	}
+template <typename Function>
+void Huffman::Tree::preorder_traversal(Function function) const {
+	struct Pending {
+		uint16_t node;
+		uint16_t depth;
+		bool bit;
+	};
+
+	// A parent has two children, so no path is longer than the number of parents
+	Path path;
+	std::array<Pending, MAX_NODES> stack;
+	uint16_t stack_size = 0;
+
+	stack[stack_size++] = { m_Root, 0, false };
 
-	Code left_code = current_code;
-	left_code <<= false;
+	while(stack_size > 0) {
+		Pending current = stack[--stack_size];
+		const Node& node = m_Nodes[current.node];
 
-	Code right_code = current_code;
-	right_code <<= true;
+		// The path up to the parent is already in place, as the parent was visited just before its subtree
+		if(current.depth > 0) {
+			path[current.depth - 1] = current.bit;
+		}
+
+		function(node, path, current.depth);
 
-	generate_codes(code_dict, current_node->get_left(), left_code);
-	generate_codes(code_dict, current_node->get_right(), right_code);
+		// The left child is pushed last to be visited first
+		if(!node.leaf) {
+			stack[stack_size++] = { node.right, static_cast<uint16_t>(current.depth + 1), true };
+			stack[stack_size++] = { node.left, static_cast<uint16_t>(current.depth + 1), false };
+		}
+	}
 }
 
 Huffman::Tree::CodeDictionary Huffman::Tree::get_codes() const {
 	CodeDictionary result;
 
-	generate_codes(result, m_Root, Code());
+	preorder_traversal([&result](const Node& node, const Path& path, uint16_t depth) {
+		if(node.leaf) {
+			result[node.character] = make_code(path, depth);
+		}
+	});
 
 	return result;
 }
 
-void Huffman::Tree::generate_codes_for_decoding(CharacterDictionary& code_dict, const std::unique_ptr<Node>& current_node, Code current_code) const {
-	if(current_node->get_character() != '\0') {
-		code_dict[current_code] = current_node->get_character();
-		return;
+Huffman::Tree::CharacterDictionary Huffman::Tree::get_codes_for_decoding() const {
+	CharacterDictionary result;
+
+	preorder_traversal([&result](const Node& node, const Path& path, uint16_t depth) {
+		if(node.leaf) {
+			result[make_code(path, depth)] = node.character;
+		}
+	});
+
+	return result;
+}
+
+Huffman::Tree::CodeLengths Huffman::Tree::get_code_lengths() const {
+	CodeLengths result;
+	result.fill(0);
+
+	preorder_traversal([&result](const Node& node, const Path&, uint16_t depth) {
+		if(node.leaf) {
+			result[node.character] = depth;
+		}
+	});
+
+	return result;
+}
+
+Huffman::Tree::CodeTable Huffman::Tree::get_code_table() const {
+	CodeTable result;
+	result.fill({ 0, 0 });
+
+	preorder_traversal([&result](const Node& node, const Path& path, uint16_t depth) {
+		if(!node.leaf) {
+			return;
+		}
+
+		uint64_t bits = 0;
+
+		for(uint16_t i = 0; i < depth; i++) {
+			bits = (bits << 1) | path[i];
+		}
+
+		result[node.character] = { bits, static_cast<uint8_t>(depth) };
+	});
+
+	return result;
+}
+
+Huffman::Tree::CanonicalCodes Huffman::Tree::canonical_codes(const CodeLengths& code_lengths) {
+	// Count the codes of every length
+	std::array<uint64_t, MAX_CODE_LENGTH + 1> length_counts;
+	length_counts.fill(0);
+
+	for(uint8_t length : code_lengths) {
+		if(length > 0) {
+			length_counts[length]++;
+		}
 	}
 
-	Code left_code = current_code;
-	left_code <<= false;
+	// The first code of each length follows the last code of the previous length
+	std::array<uint64_t, MAX_CODE_LENGTH + 1> next_code;
+	next_code[0] = 0;
+
+	for(uint8_t length = 1; length <= MAX_CODE_LENGTH; length++) {
+		next_code[length] = (next_code[length - 1] + length_counts[length - 1]) << 1;
+	}
 
-	Code right_code = current_code;
-	right_code <<= true;
+	CanonicalCodes result;
+	result.fill(0);
 
-	generate_codes_for_decoding(code_dict, current_node->get_left(), left_code);
-	generate_codes_for_decoding(code_dict, current_node->get_right(), right_code);
+	for(uint16_t character = 0; character < code_lengths.size(); character++) {
+		if(code_lengths[character] > 0) {
+			result[character] = next_code[code_lengths[character]]++;
+		}
+	}
+
+	return result;
 }
 
-Huffman::Tree::CharacterDictionary Huffman::Tree::get_codes_for_decoding() const {
-	CharacterDictionary result;
+Huffman::Tree Huffman::Tree::from_code_lengths(const CodeLengths& code_lengths) {
+	// Make sure the lengths describe a complete prefix code (Kraft equality)
+	uint64_t kraft_sum = 0;
+	uint16_t character_count = 0;
 
-	generate_codes_for_decoding(result, m_Root, Code());
+	for(uint8_t length : code_lengths) {
+		if(length > MAX_CODE_LENGTH) {
+			throw DeserializationException();
+		}
+
+		if(length > 0) {
+			kraft_sum += uint64_t(1) << (MAX_CODE_LENGTH - length);
+			character_count++;
+		}
+	}
+
+	if(character_count < 2 || kraft_sum != uint64_t(1) << MAX_CODE_LENGTH) {
+		throw DeserializationException();
+	}
+
+	CanonicalCodes codes = canonical_codes(code_lengths);
+
+	// A complete prefix code of n characters has exactly n - 1 parents, so the nodes always fit
+	Tree result;
+	result.m_Root = result.add_node(false, 0, 0);
+
+	for(uint16_t character = 0; character < code_lengths.size(); character++) {
+		uint8_t length = code_lengths[character];
+
+		if(length == 0) {
+			continue;
+		}
+
+		uint16_t node = result.m_Root;
+
+		for(uint8_t bit_index = 0; bit_index < length; bit_index++) {
+			bool bit = (codes[character] >> (length - 1 - bit_index)) & 1;
+			bool last = bit_index == length - 1;
+
+			uint16_t& child = bit ? result.m_Nodes[node].right : result.m_Nodes[node].left;
+
+			if(child == NO_NODE) {
+				child = result.add_node(last, last ? character : 0, 0);
+			}
+
+			node = child;
+		}
+	}
 
 	return result;
 }
 
-Huffman::Buffer Huffman::Tree::serialize() const {
+Huffman::Buffer Huffman::Tree::serialize_code_lengths() const {
+	CodeLengths code_lengths = get_code_lengths();
+
+	uint16_t character_count = std::count_if(code_lengths.begin(), code_lengths.end(), [](uint8_t length) {
+		return length > 0;
+	});
+
 	Buffer output;
 
-	preorder_serialization(output, m_Root);
+	// Few characters are stored as (character, length) pairs, otherwise the whole table is stored
+	// A zero count marks the full table
+	if(character_count * 2 < code_lengths.size()) {
+		output <<= std::byte(character_count);
+
+		for(uint16_t character = 0; character < code_lengths.size(); character++) {
+			if(code_lengths[character] > 0) {
+				output <<= std::byte(character);
+				output <<= std::byte(code_lengths[character]);
+			}
+		}
+	} else {
+		output <<= std::byte(0);
+
+		for(uint8_t length : code_lengths) {
+			output <<= std::byte(length);
+		}
+	}
 
 	return output;
 }
 
-void Huffman::Tree::preorder_serialization(Buffer& output, const std::unique_ptr<Node>& current_node) const {
-	if(current_node->get_character()) {
-		output <<= true;
+Huffman::Tree::CodeLengths Huffman::Tree::deserialize_code_lengths(const Buffer& buffer) {
+	CodeLengths result;
+	result.fill(0);
 
-		output <<= std::byte(current_node->get_character());
-	} else {
-		output <<= false;
+	BitReader input(buffer);
 
-		preorder_serialization(output, current_node->get_left());
-		preorder_serialization(output, current_node->get_right());
+	uint8_t character_count = read_bits_checked(input, 8);
+
+	if(character_count == 0) {
+		for(uint8_t& length : result) {
+			length = read_bits_checked(input, 8);
+		}
+	} else {
+		for(uint8_t i = 0; i < character_count; i++) {
+			uint8_t character = read_bits_checked(input, 8);
+			result[character] = read_bits_checked(input, 8);
+		}
 	}
+
+	return result;
 }
 
-Huffman::Tree Huffman::Tree::deserialize(const Buffer& buffer) {
-	auto it = buffer.bit_begin();
+Huffman::Buffer Huffman::Tree::serialize() const {
+	Buffer output;
 
-	try {
-		if(*it) {
-			++it;
-			return Tree(std::to_integer<uint8_t>(it.next_byte(buffer.bit_end())), 0);
+	preorder_traversal([&output](const Node& node, const Path&, uint16_t) {
+		if(node.leaf) {
+			output <<= true;
+			output <<= std::byte(node.character);
+		} else {
+			output <<= false;
 		}
+	});
 
-		++it;
+	return output;
+}
 
-		Tree result('\0', 0);
+Huffman::Tree Huffman::Tree::deserialize(const Buffer& buffer) {
+	BitReader input(buffer);
 
-		preorder_deserialization(result.m_Root, it, buffer.bit_end());
+	// Child slots waiting to be filled, the left child of a parent being filled first
+	struct Slot {
+		uint16_t parent;
+		uint16_t depth;
+		bool right;
+	};
 
-		return result;
-	} catch(const Buffer::BitIterator::IteratorEndReachedException& e) {
-		throw DeserializationException();
-	}
-}
+	Tree result;
+
+	std::array<Slot, MAX_NODES> stack;
+	uint16_t stack_size = 0;
 
-void Huffman::Tree::preorder_deserialization(std::unique_ptr<Node>& root, Buffer::BitIterator& input, const Buffer::BitIterator& end) {
-	for(int i = 0; i < 2; i++) {
-		if(input == end) {
-			throw Buffer::BitIterator::IteratorEndReachedException();
+	auto read_node = [&result, &input](uint16_t depth) {
+		if(result.m_NodesNum == MAX_NODES) {
+			throw DeserializationException();
 		}
 
-		bool character_in_node = *input;
-		++input;
+		bool character_in_node = read_bits_checked(input, 1);
 
 		if(character_in_node) {
-			auto character = std::to_integer<uint8_t>(input.next_byte(end));
+			return result.add_node(true, read_bits_checked(input, 8), 0);
+		}
+
+		// No tree of 256 characters has leaves deeper than that, so the data has to be invalid
+		if(depth >= 255) {
+			throw DeserializationException();
+		}
 
-			if(i == 0)
-				root->push_left(std::make_unique<Node>(character, 0));
-			else
-				root->push_right(std::make_unique<Node>(character, 0));
+		return result.add_node(false, 0, 0);
+	};
+
+	result.m_Root = read_node(0);
+
+	if(!result.m_Nodes[result.m_Root].leaf) {
+		stack[stack_size++] = { result.m_Root, 1, true };
+		stack[stack_size++] = { result.m_Root, 1, false };
+	}
+
+	while(stack_size > 0) {
+		Slot slot = stack[--stack_size];
+		uint16_t node = read_node(slot.depth);
+
+		if(slot.right) {
+			result.m_Nodes[slot.parent].right = node;
 		} else {
-			auto node = std::make_unique<Node>('\0', 0);
-			preorder_deserialization(node, input, end);
-			if(i == 0)
-				root->push_left(std::move(node));
-			else
-				root->push_right(std::move(node));
+			result.m_Nodes[slot.parent].left = node;
+		}
+
+		if(!result.m_Nodes[node].leaf) {
+			stack[stack_size++] = { node, static_cast<uint16_t>(slot.depth + 1), true };
+			stack[stack_size++] = { node, static_cast<uint16_t>(slot.depth + 1), false };
 		}
 	}
+
+	return result;
+}
+
+uint64_t Huffman::Tree::read_bits_checked(BitReader& input, uint8_t count) {
+	if(input.get_remaining() < count) {
+		throw DeserializationException();
+	}
+
+	return input.read_bits(count);
 }
 
 Huffman::Tree::DeserializationException::DeserializationException() {
@@ -2,46 +2,78 @@
 
 #include "../buffer/buffer.hpp"
 
-#include <memory>
+#include <array>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
 namespace Huffman {
-	class Tree {
-		class Node {
-			std::unique_ptr<Node> m_Left;
-			std::unique_ptr<Node> m_Right;
-
-			uint64_t m_Occurences;
-			uint8_t m_Character;
-		public:
-			Node(uint8_t character, uint64_t occurences);
+	class BitReader;
 
-			void push_left(std::unique_ptr<Node>&& node);
-			void push_right(std::unique_ptr<Node>&& node);
+	/// @brief A Huffman tree stored as a flat array of nodes, referring to each other by index
+	/// The nodes live inside the tree itself, so building and destroying a tree doesn't allocate
+	class Tree {
+	public:
+		/// @brief The most nodes a tree of 256 characters can have
+		static constexpr uint16_t MAX_NODES = 511;
 
-			uint8_t get_character() const;
-			uint64_t get_occurances() const;
-			const std::unique_ptr<Node>& get_left() const;
-			const std::unique_ptr<Node>& get_right() const;
+	private:
+		/// @brief Marks a missing child
+		static constexpr uint16_t NO_NODE = UINT16_MAX;
+
+		struct Node {
+			uint64_t occurances;
+			uint16_t left;
+			uint16_t right;
+			uint8_t character;
+			/// @brief Leaves are marked explicitly, so that every byte value can be a character
+			bool leaf;
 		};
 
-		std::unique_ptr<Node> m_Root;
+		std::array<Node, MAX_NODES> m_Nodes;
+		uint16_t m_NodesNum;
+		uint16_t m_Root;
 
 	public:
 		using Code = Buffer;
 		using CodeDictionary = std::unordered_map<uint8_t, Code>;
 		using CharacterDictionary = std::unordered_map<Code, uint8_t>;
+		/// @brief Length of the code of every character, zero for characters absent from the tree
+		using CodeLengths = std::array<uint8_t, 256>;
+		using CanonicalCodes = std::array<uint64_t, 256>;
+
+		/// @brief A code stored in the lowest bits of an integer, the first bit being the most significant one
+		struct CodeWord {
+			uint64_t bits;
+			uint8_t length;
+		};
+		using CodeTable = std::array<CodeWord, 256>;
+
+		/// @brief The longest code supported by canonical mode and code tables, so that every code fits in a bit writer's word
+		static constexpr uint8_t MAX_CODE_LENGTH = 57;
+
+		/// @brief Initialize an empty tree, to be built bottom-up with `add_leaf` and `add_parent`
+		Tree();
 
 		/// @brief Initialize a single-node Huffman tree
 		Tree(uint8_t character, uint64_t occurences);
 
-		/// @brief Fuses two trees together under one root
-		Tree(Tree&& left_tree, Tree&& right_tree);
+		/// @brief Adds a leaf, which becomes the root until another node is added
+		/// @return The index of the new node
+		uint16_t add_leaf(uint8_t character, uint64_t occurences);
+
+		/// @brief Adds a parent of two nodes added before, which becomes the root until another node is added
+		/// @return The index of the new node
+		uint16_t add_parent(uint16_t left, uint16_t right);
 
 		uint64_t get_occurances() const;
 		CodeDictionary get_codes() const;
 		CharacterDictionary get_codes_for_decoding() const;
+		CodeLengths get_code_lengths() const;
+
+		/// @brief Gets the codes as integers, characters absent from the tree having zero-length codes
+		/// Codes longer than `MAX_CODE_LENGTH` are not supported
+		CodeTable get_code_table() const;
 
 		/// @brief Serializes the tree using preorder traversal
 		/// @return A buffer which the tree is serialized into
@@ -52,18 +84,34 @@ namespace Huffman {
 		/// @return A tree constructed from the serialized data
 		static Tree deserialize(const Buffer& buffer);
 
-	private:
-		// A helper function for the `get_codes` method
-		void generate_codes(CodeDictionary& code, const std::unique_ptr<Node>& current_node, Code current_code) const;
+		/// @brief Constructs a tree whose codes are the canonical codes for the given lengths
+		/// @param code_lengths Code lengths satisfying the Kraft equality, none longer than `MAX_CODE_LENGTH`
+		static Tree from_code_lengths(const CodeLengths& code_lengths);
+
+		/// @brief Assigns canonical codes: shorter codes come first, ties are ordered by the character
+		/// @return The codes stored in the lowest bits, the first bit of a code being the most significant one
+		static CanonicalCodes canonical_codes(const CodeLengths& code_lengths);
 
-		// A helper function for the `get_codes_for_decoding` method
-		void generate_codes_for_decoding(CharacterDictionary& code, const std::unique_ptr<Node>& current_node, Code current_code) const;
+		/// @brief Serializes only the code lengths of the tree, enough to rebuild its canonical form
+		/// @return A buffer which the code lengths are serialized into
+		Buffer serialize_code_lengths() const;
+
+		/// @brief Deserializes code lengths serialized using the `serialize_code_lengths` method
+		/// @param buffer A buffer containing the serialized data
+		/// @return The code lengths as read, unchecked, so they have to go through `from_code_lengths` before they're used
+		static CodeLengths deserialize_code_lengths(const Buffer& buffer);
+
+	private:
+		// Adds a node without children, throwing if the tree is full
+		uint16_t add_node(bool leaf, uint8_t character, uint64_t occurances);
 
-		// A helper function for the `serialize` method
-		void preorder_serialization(Buffer& output, const std::unique_ptr<Node>& current_node) const;
+		// Visits every node in preorder without recursion
+		// The function gets the node, the bits of the path leading to it and the depth of the node
+		template <typename Function>
+		void preorder_traversal(Function function) const;
 
-		// A helper function for the `deserialize` method
-		static void preorder_deserialization(std::unique_ptr<Node>& root, Buffer::BitIterator& input, const Buffer::BitIterator& end);
+		// Reads bits, throwing if the data ends before them
+		static uint64_t read_bits_checked(BitReader& input, uint8_t count);
 
 	public:
 		class DeserializationException : public std::exception {
@@ -1,9 +1,104 @@
 #include "interface.hpp"
 
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <streambuf>
 
+#include "huffman/context/context.hpp"
+#include "huffman/decoder/decoder.hpp"
+#include "huffman/file/file.hpp"
 #include "huffman/huffman.hpp"
+#include "huffman/profile/profile.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+	// Output is gathered into large writes, the blocks are large anyway but the headers between them aren't
+	const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+	// Gathers everything written to the standard output into large writes, for as long as it exists
+	// The standard streams have to be unsynchronized for the input to be buffered too, so that it can be taken in large pieces
+	class StandardStreams : public std::streambuf {
+		std::vector<char> m_Buffer;
+		std::streambuf* m_PreviousBuffer;
+
+	public:
+		StandardStreams()
+			: m_Buffer(OUTPUT_BUFFER_SIZE) {
+			std::ios::sync_with_stdio(false);
+
+			// Encoded messages are binary, so the standard streams mustn't translate line endings
+#ifdef _WIN32
+			_setmode(_fileno(stdin), _O_BINARY);
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+			// Everything is buffered here already
+			std::setvbuf(stdout, nullptr, _IONBF, 0);
+
+			setp(m_Buffer.data(), m_Buffer.data() + m_Buffer.size());
+			m_PreviousBuffer = std::cout.rdbuf(this);
+		}
+
+		~StandardStreams() override {
+			sync();
+			std::cout.rdbuf(m_PreviousBuffer);
+		}
+
+		StandardStreams(const StandardStreams&) = delete;
+		StandardStreams& operator=(const StandardStreams&) = delete;
+
+	protected:
+		int_type overflow(int_type character) override {
+			if(sync() != 0) {
+				return traits_type::eof();
+			}
+
+			if(!traits_type::eq_int_type(character, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(character);
+				pbump(1);
+			}
+
+			return traits_type::not_eof(character);
+		}
+
+		std::streamsize xsputn(const char* data, std::streamsize size) override {
+			if(size > epptr() - pptr()) {
+				if(sync() != 0) {
+					return 0;
+				}
+
+				// Writes as large as the buffer go straight out
+				if(size >= epptr() - pptr()) {
+					return std::fwrite(data, 1, size, stdout);
+				}
+			}
+
+			std::memcpy(pptr(), data, size);
+			pbump(size);
+
+			return size;
+		}
+
+		int sync() override {
+			size_t size = pptr() - pbase();
+
+			if(size > 0 && std::fwrite(pbase(), 1, size, stdout) != size) {
+				return -1;
+			}
+
+			setp(m_Buffer.data(), m_Buffer.data() + m_Buffer.size());
+
+			return std::fflush(stdout) == 0 ? 0 : -1;
+		}
+	};
+}
 
 Action::Action(const std::vector<std::string>& args) {
 	if(args.size() < 1) {
@@ -20,8 +115,16 @@ Action::Action(const std::vector<std::string>& args) {
 		m_Type = ActionType::Decode;
 	} else if(action_name == "decode-to-file" || action_name == "df") {
 		m_Type = ActionType::DecodeToFile;
+	} else if(action_name == "decode-range" || action_name == "dr") {
+		m_Type = ActionType::DecodeRange;
+	} else if(action_name == "verify" || action_name == "v") {
+		m_Type = ActionType::Verify;
+	} else if(action_name == "train" || action_name == "tr") {
+		m_Type = ActionType::Train;
 	} else if(action_name == "encode" || action_name == "e") {
 		m_Type = ActionType::Encode;
+	} else if(action_name == "encode-stream" || action_name == "es") {
+		m_Type = ActionType::EncodeStream;
 	} 
 #ifdef HFF_DEBUG
 	else if(action_name == "test" || action_name == "t") {
@@ -34,10 +137,27 @@ Action::Action(const std::vector<std::string>& args) {
 		throw UnknownActionException(action_name);
 	}
 
-	m_Args = std::vector<std::string>(args.size() - 2);
-
 	for(uint16_t i = 2; i < args.size(); i++) {
-		m_Args[i - 2] = args[i];
+		if(args[i].rfind("--", 0) != 0) {
+			m_Args.push_back(args[i]);
+			continue;
+		}
+
+		std::string option_name = args[i].substr(2);
+
+		if(!is_known_option(option_name)) {
+			throw UnknownOptionException(option_name);
+		}
+
+		if(option_takes_value(option_name)) {
+			if(i + 1u == args.size()) {
+				throw MissingOptionValueException(option_name);
+			}
+
+			m_Options[option_name] = args[++i];
+		} else {
+			m_Options[option_name] = "";
+		}
 	}
 
 	if(m_Args.size() != expected_arg_count(m_Type)) {
@@ -53,9 +173,21 @@ std::string Action::action_name(ActionType action_type) {
 	case ActionType::DecodeToFile:
 		return "decode-to-file";
 
+	case ActionType::DecodeRange:
+		return "decode-range";
+
+	case ActionType::Verify:
+		return "verify";
+
+	case ActionType::Train:
+		return "train";
+
 	case ActionType::Encode:
 		return "encode";
 
+	case ActionType::EncodeStream:
+		return "encode-stream";
+
 #ifdef HFF_DEBUG
 	case ActionType::Test:
 		return "test";
@@ -76,9 +208,21 @@ uint16_t Action::expected_arg_count(ActionType action_type) {
 	case ActionType::DecodeToFile:
 		return 2;
 
+	case ActionType::DecodeRange:
+		return 3;
+
+	case ActionType::Verify:
+		return 1;
+
+	case ActionType::Train:
+		return 2;
+
 	case ActionType::Encode:
 		return 2;
 
+	case ActionType::EncodeStream:
+		return 0;
+
 #ifdef HFF_DEBUG
 	case ActionType::Test:
 		return 1;
@@ -91,7 +235,68 @@ uint16_t Action::expected_arg_count(ActionType action_type) {
 	return 0;
 }
 
+bool Action::is_known_option(const std::string& name) {
+	return name == "canonical" || name == "stats" || name == "stats-json" || name == "seek-index" || name == "fixed-blocks" || name == "no-checksums" || option_takes_value(name);
+}
+
+bool Action::option_takes_value(const std::string& name) {
+	return name == "block-size" || name == "threads" || name == "max-code-len" || name == "streams" || name == "dictionary" || name == "trace" || name == "contexts";
+}
+
+bool Action::has_option(const std::string& name) const {
+	return m_Options.find(name) != m_Options.end();
+}
+
+uint64_t Action::parse_size_option(const std::string& name) const {
+	const std::string& value = m_Options.at(name);
+
+	try {
+		size_t parsed_chars;
+		uint64_t result = std::stoull(value, &parsed_chars);
+
+		if(parsed_chars == value.size() && result > 0) {
+			return result;
+		}
+	} catch(const std::logic_error& e) {}
+
+	throw InvalidOptionValueException(name, value);
+}
+
+size_t Action::parse_threads_option() const {
+	uint64_t threads = parse_size_option("threads");
+
+	if(threads > MAX_THREADS) {
+		throw InvalidOptionValueException("threads", m_Options.at("threads"));
+	}
+
+	return threads;
+}
+
+uint64_t Action::parse_number_argument(size_t index) const {
+	const std::string& value = m_Args[index];
+
+	try {
+		size_t parsed_chars;
+		uint64_t result = std::stoull(value, &parsed_chars);
+
+		// Unlike stoull, negative numbers aren't wrapped around
+		if(parsed_chars == value.size() && value[0] != '-') {
+			return result;
+		}
+	} catch(const std::logic_error& e) {}
+
+	throw InvalidArgumentException(value);
+}
+
 void Action::perform() const {
+	StandardStreams standard_streams;
+
+	bool profiled = has_option("stats") || has_option("stats-json") || has_option("trace");
+
+	if(profiled) {
+		Huffman::Profiler::enable(has_option("trace"));
+	}
+
 	switch(m_Type) {
 	case ActionType::Decode:
 		decode();
@@ -101,10 +306,26 @@ void Action::perform() const {
 		decode_to_file();
 		break;
 
+	case ActionType::DecodeRange:
+		decode_range();
+		break;
+
+	case ActionType::Verify:
+		verify();
+		break;
+
+	case ActionType::Train:
+		train();
+		break;
+
 	case ActionType::Encode:
 		encode();
 		break;
 
+	case ActionType::EncodeStream:
+		encode_stream();
+		break;
+
 #ifdef HFF_DEBUG
 	case ActionType::Test:
 		test();
@@ -115,64 +336,304 @@ void Action::perform() const {
 		help();
 		break;
 	}
+
+	if(profiled) {
+		print_profile();
+	}
+
+	// Whatever went to the standard output has to be written out before succeeding
+	if(!std::cout.flush()) {
+		throw FailedFileWriteException(STANDARD_STREAM);
+	}
 }
 
-void Action::decode() const {
-	std::ifstream input(m_Args[0], std::ios::binary | std::ios::in);
+std::shared_ptr<const Huffman::Dictionary> Action::load_dictionary() const {
+	if(!has_option("dictionary")) {
+		return nullptr;
+	}
 
-	if(!input.good()) {
-		throw FailedFileReadException(m_Args[0]);
+	const std::string& filename = m_Options.at("dictionary");
+	Huffman::MappedFile input(filename);
+
+	if(!input.is_open()) {
+		throw FailedFileReadException(filename);
 	}
 
-	auto deserialized_message = Huffman::EncodedMessage::deserialize(input);
+	return std::make_shared<const Huffman::Dictionary>(Huffman::Dictionary::deserialize(input.get_bytes()));
+}
 
-	input.close();
+Huffman::DecodeOptions Action::decode_options() const {
+	Huffman::DecodeOptions options;
+	options.dictionary = load_dictionary();
+
+	if(has_option("threads")) {
+		options.threads = parse_threads_option();
+	}
+
+	return options;
+}
 
-	Huffman::decode(deserialized_message, std::cout);
+void Action::decode() const {
+	decode_input(std::cout);
 }
 
 void Action::decode_to_file() const {
-	std::ifstream input(m_Args[0], std::ios::binary | std::ios::in);
+	std::vector<char> output_buffer;
+	std::ofstream file;
+	std::ostream& output = open_output_file(file, output_buffer, m_Args[1]);
 
-	if(!input.good()) {
-		throw FailedFileReadException(m_Args[0]);
+	decode_input(output);
+
+	close_output_file(file, m_Args[1]);
+}
+
+void Action::decode_input(std::ostream& output) const {
+	// The standard input is decoded block by block as it comes, instead of reading it whole first
+	if(m_Args[0] == STANDARD_STREAM) {
+		Huffman::decode(std::cin, output, decode_options());
+
+		return;
 	}
 
-	auto deserialized_message = Huffman::EncodedMessage::deserialize(input);
+	std::unique_ptr<Huffman::MappedFile> input = open_input_file(m_Args[0]);
 
-	input.close();
+	Huffman::decode(input->get_bytes(), output, decode_options());
+}
+
+void Action::decode_range() const {
+	std::unique_ptr<Huffman::MappedFile> input = open_input_file(m_Args[0]);
+
+	uint64_t offset = parse_number_argument(1);
+	uint64_t length = parse_number_argument(2);
+
+	Huffman::decode_range(input->get_bytes(), offset, length, std::cout, decode_options());
+}
+
+void Action::verify() const {
+	std::unique_ptr<Huffman::MappedFile> input = open_input_file(m_Args[0]);
+
+	Huffman::VerifyStats stats = Huffman::verify(input->get_bytes());
+
+	if(stats.checksums) {
+		std::cout << "OK: " << stats.blocks << " blocks match their checksums.\n";
+	} else {
+		std::cout << "OK: " << stats.blocks << " blocks read, but the file stores no checksums, so their content wasn't checked.\n";
+	}
+}
+
+void Action::train() const {
+	std::unique_ptr<Huffman::MappedFile> input = open_input_file(m_Args[0]);
+
+	Huffman::ByteSpan sample = input->get_bytes();
+	Huffman::Dictionary dictionary = Huffman::train_dictionary(Huffman::histogram(sample.data(), sample.size()));
 
-	std::ofstream output(m_Args[1], std::ios::binary | std::ios::out);
+	std::vector<char> output_buffer;
+	std::ofstream file;
+	std::ostream& output = open_output_file(file, output_buffer, m_Args[1]);
+
+	dictionary.serialize(output);
+	close_output_file(file, m_Args[1]);
+
+	// The ID is what the messages encoded with the dictionary refer to, it goes to the standard error if the dictionary took the output
+	(m_Args[1] == STANDARD_STREAM ? std::cerr : std::cout) << Huffman::Dictionary::format_id(dictionary.get_id()) << "\n";
+}
+
+std::unique_ptr<Huffman::MappedFile> Action::open_input_file(const std::string& filename) const {
+	std::unique_ptr<Huffman::MappedFile> result = filename == STANDARD_STREAM
+		? std::make_unique<Huffman::MappedFile>(std::cin)
+		: std::make_unique<Huffman::MappedFile>(filename);
+
+	if(!result->is_open()) {
+		throw FailedFileReadException(filename);
+	}
+
+	return result;
+}
+
+std::ostream& Action::open_output_file(std::ofstream& output, std::vector<char>& buffer, const std::string& filename) const {
+	if(filename == STANDARD_STREAM) {
+		return std::cout;
+	}
+
+	// The buffer has to be set before the file is opened
+	buffer.resize(OUTPUT_BUFFER_SIZE);
+	output.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	output.open(filename, std::ios::binary | std::ios::out);
 
 	if(!output.good()) {
-		throw FailedFileWriteException(m_Args[1]);
+		throw FailedFileWriteException(filename);
 	}
 
-	Huffman::decode(deserialized_message, output);
+	return output;
+}
+
+void Action::close_output_file(std::ofstream& output, const std::string& filename) const {
+	// Buffered writes only fail once they're flushed, which closing does
+	if(filename == STANDARD_STREAM) {
+		if(!std::cout.flush()) {
+			throw FailedFileWriteException(filename);
+		}
+
+		return;
+	}
 
 	output.close();
+
+	if(output.fail()) {
+		throw FailedFileWriteException(filename);
+	}
+}
+
+Huffman::EncodeOptions Action::encode_options() const {
+	Huffman::EncodeOptions options;
+	options.canonical = has_option("canonical");
+	options.seek_index = has_option("seek-index");
+	options.adaptive_blocks = !has_option("fixed-blocks");
+	options.checksums = !has_option("no-checksums");
+	options.dictionary = load_dictionary();
+
+	if(has_option("block-size")) {
+		options.block_size = parse_size_option("block-size");
+	}
+
+	if(has_option("threads")) {
+		options.threads = parse_threads_option();
+	}
+
+	// Longer codes wouldn't fit a single-lookup decode table, shorter ones cost too much ratio
+	if(has_option("max-code-len")) {
+		uint64_t max_code_length = parse_size_option("max-code-len");
+
+		if(max_code_length < 11 || max_code_length > Huffman::DecodeTable::MAX_LOOKUP_BITS) {
+			throw InvalidOptionValueException("max-code-len", m_Options.at("max-code-len"));
+		}
+
+		options.max_code_length = max_code_length;
+	}
+
+	if(has_option("streams")) {
+		options.streams = parse_size_option("streams");
+
+		if(options.streams > MAX_STREAMS) {
+			throw InvalidOptionValueException("streams", m_Options.at("streams"));
+		}
+	}
+
+	if(has_option("contexts")) {
+		options.context_tables = parse_size_option("contexts");
+
+		if(options.context_tables < 2 || options.context_tables > Huffman::ContextModel::MAX_TABLES) {
+			throw InvalidOptionValueException("contexts", m_Options.at("contexts"));
+		}
+	}
+
+	return options;
 }
 
 void Action::encode() const {
-	std::ifstream input(m_Args[0], std::ios::binary | std::ios::in);
+	Huffman::EncodeOptions options = encode_options();
 
-	if(!input.good()) {
-		throw FailedFileReadException(m_Args[0]);
+	// The standard input is encoded block by block as it comes, instead of reading it whole first
+	std::unique_ptr<Huffman::MappedFile> input;
+
+	if(m_Args[0] != STANDARD_STREAM) {
+		input = open_input_file(m_Args[0]);
 	}
 
-	auto message = Huffman::encode(input);
+	std::vector<char> output_buffer;
+	std::ofstream file;
+	std::ostream& output = open_output_file(file, output_buffer, m_Args[1]);
 
-	input.close();
+	Huffman::StreamSink sink(output);
+	Huffman::EncodeStats stats;
 
-	std::ofstream output(m_Args[1], std::ios::binary | std::ios::out);
+	if(input) {
+		Huffman::encode(input->get_bytes(), sink, options, stats);
+	} else {
+		Huffman::encode(std::cin, output, options, stats);
+	}
 
-	if(!output.good()) {
-		throw FailedFileWriteException(m_Args[1]);
+	close_output_file(file, m_Args[1]);
+
+	if(has_option("stats")) {
+		print_stats(stats, options);
 	}
+}
 
-	message.serialize(output);
+void Action::encode_stream() const {
+	Huffman::EncodeOptions options = encode_options();
 
-	output.close();
+	if(!has_option("block-size")) {
+		options.block_size = STREAM_BLOCK_SIZE;
+	}
+
+	// Blocks written in a single pass end where the codes are rebuilt
+	options.adaptive_blocks = false;
+
+	Huffman::StreamSink sink(std::cout);
+	Huffman::EncodeStats stats;
+	Huffman::encode_stream(std::cin, sink, options, stats);
+
+	if(has_option("stats")) {
+		print_stats(stats, options);
+	}
+}
+
+void Action::print_stats(const Huffman::EncodeStats& stats, const Huffman::EncodeOptions& options) const {
+	auto percent = [](uint64_t part, uint64_t whole) {
+		return whole > 0 ? 100.0 * part / whole : 0.0;
+	};
+
+	std::cerr << std::fixed << std::setprecision(2)
+		<< "Input:   " << stats.input_size << " bytes\n"
+		<< "Output:  " << stats.output_size << " bytes (" << percent(stats.output_size, stats.input_size) << "% of the input)\n"
+		<< "Blocks:  " << stats.blocks << " (" << stats.run_blocks << " runs, " << stats.trees << " trees stored";
+
+	if(options.adaptive_blocks) {
+		std::cerr << ", " << stats.splits << " cuts where the statistics changed";
+	}
+
+	if(options.context_tables > 0) {
+		std::cerr << ", " << stats.context_blocks << " with order-1 tables";
+	}
+
+	std::cerr << ")\n";
+
+	if(options.max_code_length > 0) {
+		uint64_t cost_bytes = (stats.length_limit_cost + 7) / 8;
+
+		std::cerr << "Code length limit of " << static_cast<uint32_t>(options.max_code_length) << " bits cost: "
+			<< cost_bytes << " bytes (" << percent(cost_bytes, stats.output_size) << "% of the output)\n";
+	}
+}
+
+void Action::print_profile() const {
+	// Builds without instrumentation still print the sizes of the encoding for --stats
+	if(!Huffman::Profiler::is_compiled()) {
+		std::cerr << "This build isn't instrumented, build it with `make PROFILE=1` for the phases and counters.\n";
+
+		return;
+	}
+
+	if(has_option("stats")) {
+		Huffman::Profiler::write_report(std::cerr);
+	}
+
+	// The standard output may be taken by the decoded content, so the report goes to the standard error as well
+	if(has_option("stats-json")) {
+		Huffman::Profiler::write_json_report(std::cerr);
+	}
+
+	if(has_option("trace")) {
+		const std::string& filename = m_Options.at("trace");
+		std::ofstream trace(filename, std::ios::out);
+
+		if(!trace.good()) {
+			throw FailedFileWriteException(filename);
+		}
+
+		Huffman::Profiler::write_trace(trace);
+	}
 }
 
 #ifdef HFF_DEBUG
@@ -201,23 +662,85 @@ void Action::help() const {
 		<< "   \\ \\__\\ \\__\\ \\__\\   \\ \\__\\ \n"
 		<< "    \\|__|\\|__|\\|__|    \\|__| \n\n"
 
-		<< "Usage: hff.exe <command> <args>\n"
+		<< "Usage: hff.exe <command> <args> [options]\n"
+		<< "Input and output files can be given as - for the standard input and output.\n"
+		<< "The phases and counters of --stats, --stats-json and --trace are only in builds made with `make PROFILE=1`.\n"
 		<< "Available commands:\n"
 
 		<< "\tencode / e\n"
 		<< "\t\targs: <input file> <output file>\n"
 		<< "\t\tencodes the input file using Huffman encoding"
 		<< "and serializes the results into the output file.\n"
+		<< "\t\toptions:\n"
+		<< "\t\t\t--canonical        store canonical code lengths instead of the whole tree\n"
+		<< "\t\t\t--block-size <n>   encode the input in blocks of at most n bytes\n"
+		<< "\t\t\t--fixed-blocks     cut blocks only every --block-size bytes, not also where the statistics of the input change\n"
+		<< "\t\t\t--threads <n>      encode n blocks at a time (up to 256)\n"
+		<< "\t\t\t--max-code-len <n> limit codes to n bits (11 to 16), so they decode with a single table lookup\n"
+		<< "\t\t\t--streams <n>      split every block into n streams (up to 16) decoded side by side\n"
+		<< "\t\t\t--seek-index       store where every block starts in the decoded content, for decode-range\n"
+		<< "\t\t\t--no-checksums     leave out the checksums of every block, which verify and decoding check\n"
+		<< "\t\t\t--contexts <n>     let the previous character pick one of up to n code tables (2 to 16) where that's smaller\n"
+		<< "\t\t\t--dictionary <f>   encode every block with the codes of the dictionary file f instead of storing trees\n"
+		<< "\t\t\t--stats            print the sizes and counters of the encoding and the time of every phase\n"
+		<< "\t\t\t--stats-json       print the time of every phase and the counters as JSON\n"
+		<< "\t\t\t--trace <f>        write the phases of every block on every thread into f, in the Chrome trace format\n"
+
+		<< "\tencode-stream / es\n"
+		<< "\t\targs: none\n"
+		<< "\t\tencodes the standard input in a single pass into the standard output, "
+		<< "passing every block on as soon as the input runs dry, with codes adapting to the input seen so far.\n"
+		<< "\t\toptions:\n"
+		<< "\t\t\t--block-size <n>   put at most n bytes into a block and rebuild the codes every n bytes (64 KiB by default)\n"
+		<< "\t\t\t--streams <n>      split every block into n streams (up to 16) decoded side by side\n"
+		<< "\t\t\t--dictionary <f>   start out with the codes of the dictionary file f\n"
+		<< "\t\t\t--no-checksums     leave out the checksums of every block, which verify and decoding check\n"
+		<< "\t\t\t--stats            print the sizes and counters of the encoding and the time of every phase\n"
+		<< "\t\t\t--stats-json       print the time of every phase and the counters as JSON\n"
+		<< "\t\t\t--trace <f>        write the phases of every block on every thread into f, in the Chrome trace format\n"
 
 		<< "\tdecode / d\n"
 		<< "\t\targs: <input file>\n"
 		<< "\t\tdecodes the input file serialized with the encode command"
 		<< "and outputs the results into cmd.\n"
+		<< "\t\toptions:\n"
+		<< "\t\t\t--threads <n>      decode n blocks at a time (up to 256)\n"
+		<< "\t\t\t--dictionary <f>   the dictionary file the input was encoded with\n"
+		<< "\t\t\t--stats            print the time of every phase and the counters of the decoding\n"
+		<< "\t\t\t--stats-json       print the time of every phase and the counters as JSON\n"
+		<< "\t\t\t--trace <f>        write the phases of every block on every thread into f, in the Chrome trace format\n"
 
 		<< "\tdecode-to-file / df\n"
 		<< "\t\targs: <input file> <output file>\n"
 		<< "\t\tdecodes the input file serialized with the encode command"
 		<< "and outputs the results into the output file.\n"
+		<< "\t\toptions:\n"
+		<< "\t\t\t--threads <n>      decode n blocks at a time (up to 256)\n"
+		<< "\t\t\t--dictionary <f>   the dictionary file the input was encoded with\n"
+		<< "\t\t\t--stats            print the time of every phase and the counters of the decoding\n"
+		<< "\t\t\t--stats-json       print the time of every phase and the counters as JSON\n"
+		<< "\t\t\t--trace <f>        write the phases of every block on every thread into f, in the Chrome trace format\n"
+
+		<< "\tdecode-range / dr\n"
+		<< "\t\targs: <input file> <offset> <length>\n"
+		<< "\t\tdecodes only the blocks covering the given range of bytes of the decoded content "
+		<< "and outputs the range into cmd.\n"
+		<< "\t\toptions:\n"
+		<< "\t\t\t--threads <n>      decode n blocks at a time (up to 256)\n"
+		<< "\t\t\t--dictionary <f>   the dictionary file the input was encoded with\n"
+		<< "\t\t\t--stats            print the time of every phase and the counters of the decoding\n"
+		<< "\t\t\t--stats-json       print the time of every phase and the counters as JSON\n"
+		<< "\t\t\t--trace <f>        write the phases of every block on every thread into f, in the Chrome trace format\n"
+
+		<< "\tverify / v\n"
+		<< "\t\targs: <input file>\n"
+		<< "\t\tchecks every block of the input file against its checksum without decoding it, "
+		<< "so that corrupted files are found at the speed they're read.\n"
+
+		<< "\ttrain / tr\n"
+		<< "\t\targs: <sample file> <dictionary file>\n"
+		<< "\t\tbuilds a dictionary out of the sample file, for encoding many small messages similar to it, "
+		<< "writes it into the dictionary file and outputs its ID into cmd.\n"
 
 		<< "\thelp / h\n"
 		<< "\t\targs: none\n"
@@ -262,6 +785,47 @@ uint16_t Action::WrongArgumentCountException::get_argument_count() const {
 	return m_ArgCount;
 }
 
+Action::UnknownOptionException::UnknownOptionException(std::string option_name) {
+	m_OptionName = option_name;
+	m_Message = "Unknown option: --" + option_name;
+}
+
+std::string Action::UnknownOptionException::get_option_name() const {
+	return m_OptionName;
+}
+
+Action::MissingOptionValueException::MissingOptionValueException(std::string option_name) {
+	m_OptionName = option_name;
+	m_Message = "Option --" + option_name + " expects a value";
+}
+
+std::string Action::MissingOptionValueException::get_option_name() const {
+	return m_OptionName;
+}
+
+Action::InvalidOptionValueException::InvalidOptionValueException(std::string option_name, std::string value) {
+	m_OptionName = option_name;
+	m_Value = value;
+	m_Message = "Invalid value of option --" + option_name + ": " + value;
+}
+
+std::string Action::InvalidOptionValueException::get_option_name() const {
+	return m_OptionName;
+}
+
+std::string Action::InvalidOptionValueException::get_value() const {
+	return m_Value;
+}
+
+Action::InvalidArgumentException::InvalidArgumentException(std::string argument) {
+	m_Argument = argument;
+	m_Message = "Invalid argument: " + argument;
+}
+
+std::string Action::InvalidArgumentException::get_argument() const {
+	return m_Argument;
+}
+
 Action::FailedFileReadException::FailedFileReadException(std::string filename) {
 	m_Filename = filename;
 	m_Message = "Couldn't read from file '" + filename + "'. Make sure it exists and you have the necessary permissions.";
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <fstream>
+#include <map>
+
+#include "huffman/file/file.hpp"
+#include "huffman/huffman.hpp"
+#include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -7,8 +14,12 @@
 class Action {
 	enum class ActionType {
 		Encode,
+		EncodeStream,
 		Decode,
 		DecodeToFile,
+		DecodeRange,
+		Verify,
+		Train,
 #ifdef HFF_DEBUG
 		Test,
 #endif
@@ -17,10 +28,51 @@ class Action {
 
 	ActionType m_Type;
 	std::vector<std::string> m_Args;
-
+	/// @brief Options given as `--name` or `--name value`, mapped to their value (empty for flags)
+	std::map<std::string, std::string> m_Options;
+
+	/// @brief More streams don't speed decoding up any further
+	static constexpr size_t MAX_STREAMS = 16;
+	/// @brief More threads than most machines run at once, every one of them takes a stack and too many fail to start
+	static constexpr size_t MAX_THREADS = 256;
+	/// @brief Codes built out of the input seen so far lag behind it, so single pass encoding rebuilds them more often by default
+	static constexpr size_t STREAM_BLOCK_SIZE = 1 << 16;
+	/// @brief The file name standing for the standard input or output
+	static constexpr const char* STANDARD_STREAM = "-";
+
+	bool has_option(const std::string& name) const;
+	/// @brief Parses the value of an option as a positive integer
+	uint64_t parse_size_option(const std::string& name) const;
+	/// @brief Parses the value of `--threads`, up to `MAX_THREADS`
+	size_t parse_threads_option() const;
+	/// @brief Parses an argument as a non-negative integer
+	uint64_t parse_number_argument(size_t index) const;
+
+	/// @brief Loads the dictionary given with `--dictionary`, if any
+	std::shared_ptr<const Huffman::Dictionary> load_dictionary() const;
+	Huffman::DecodeOptions decode_options() const;
+
+	/// @brief Gathers the options shared by the encoding actions
+	Huffman::EncodeOptions encode_options() const;
 	void encode() const;
+	void encode_stream() const;
+	void print_stats(const Huffman::EncodeStats& stats, const Huffman::EncodeOptions& options) const;
+	/// @brief Prints the phases and counters gathered by the profiler, as asked for with `--stats`, `--stats-json` and `--trace`
+	void print_profile() const;
 	void decode() const;
 	void decode_to_file() const;
+	/// @brief Decodes the input file into the output, the standard input being decoded as it comes
+	void decode_input(std::ostream& output) const;
+	void decode_range() const;
+	void verify() const;
+	void train() const;
+	/// @brief Opens a file for reading in place, `-` standing for the standard input which is read whole
+	std::unique_ptr<Huffman::MappedFile> open_input_file(const std::string& filename) const;
+	/// @brief Opens a file for writing with a large buffer, which has to outlive the stream
+	/// @return The opened file, or the standard output for `-`
+	std::ostream& open_output_file(std::ofstream& output, std::vector<char>& buffer, const std::string& filename) const;
+	/// @brief Closes a file opened with `open_output_file`, or flushes the standard output for `-`, and checks that it was written
+	void close_output_file(std::ofstream& output, const std::string& filename) const;
 #ifdef HFF_DEBUG
 	void test() const;
 #endif
@@ -29,6 +81,9 @@ class Action {
 public:
 	static std::string action_name(ActionType action_type);
 	static uint16_t expected_arg_count(ActionType action_type);
+	/// @brief Checks whether an option is known and whether it expects a value
+	static bool is_known_option(const std::string& name);
+	static bool option_takes_value(const std::string& name);
 
 	Action(const std::vector<std::string>& args);
 
@@ -74,6 +129,40 @@ public:
 		uint16_t get_argument_count() const;
 	};
 
+	class UnknownOptionException : public Exception {
+		std::string m_OptionName;
+	public:
+		UnknownOptionException(std::string option_name);
+
+		std::string get_option_name() const;
+	};
+
+	class MissingOptionValueException : public Exception {
+		std::string m_OptionName;
+	public:
+		MissingOptionValueException(std::string option_name);
+
+		std::string get_option_name() const;
+	};
+
+	class InvalidOptionValueException : public Exception {
+		std::string m_OptionName;
+		std::string m_Value;
+	public:
+		InvalidOptionValueException(std::string option_name, std::string value);
+
+		std::string get_option_name() const;
+		std::string get_value() const;
+	};
+
+	class InvalidArgumentException : public Exception {
+		std::string m_Argument;
+	public:
+		InvalidArgumentException(std::string argument);
+
+		std::string get_argument() const;
+	};
+
 	class FailedFileReadException : public Exception {
 		std::string m_Filename;
 	public:
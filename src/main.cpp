@@ -32,6 +32,22 @@ int main(int argc, const char* argv[]) {
 			<< "' expects " << expected_arg_count << (Action::expected_arg_count(e.get_action_type()) == 1 ? " argument" : " arguments")
 			<< ", supplied with " << e.get_argument_count() << ".\n";
 
+		return 1;
+	} catch(const Action::UnknownOptionException& e) {
+		std::cerr << "Unknown option: '--" << e.get_option_name() << "'. For a list of available options use `hff.exe help`\n";
+
+		return 1;
+	} catch(const Action::MissingOptionValueException& e) {
+		std::cerr << "Option '--" << e.get_option_name() << "' expects a value.\n";
+
+		return 1;
+	} catch(const Action::InvalidOptionValueException& e) {
+		std::cerr << "Invalid value '" << e.get_value() << "' of option '--" << e.get_option_name() << "'.\n";
+
+		return 1;
+	} catch(const Action::InvalidArgumentException& e) {
+		std::cerr << "Invalid argument '" << e.get_argument() << "', expected a number.\n";
+
 		return 1;
 	} catch(const Action::FailedFileReadException& e) {
 		std::cerr << "Failed to read from file '" << e.get_filename() << "'. Make sure it exists and you have the necessary permissions.\n";
@@ -41,8 +57,8 @@ int main(int argc, const char* argv[]) {
 		std::cerr << "Failed to write to file '" << e.get_filename() << "'. Make sure you have the necessary permissions.\n";
 
 		return 1;
-	} catch(const Huffman::OneCharacterSourceException& e) {
-		std::cerr << "Encoding single character sequences is currently not supported.\n";
+	} catch(const Huffman::BlockTooLargeException& e) {
+		std::cerr << "The block size is too large, the codes would get too long. Try a smaller --block-size.\n";
 
 		return 1;
 	} catch(const Huffman::EncodedMessage::UnexpectedEofException& e) {
@@ -64,6 +80,36 @@ int main(int argc, const char* argv[]) {
 	} catch(const Huffman::EncodedMessage::InvalidTreeDataException& e) {
 		std::cerr << "The tree data is invalid. Given file may be corrupted.\n";
 
+		return 1;
+	} catch(const Huffman::EncodedMessage::InvalidBlockIndexException& e) {
+		std::cerr << "The block index doesn't match the blocks. Given file may be corrupted.\n";
+
+		return 1;
+	} catch(const Huffman::EncodedMessage::InvalidBlockLengthException& e) {
+		std::cerr << "A block doesn't decode to its stored length. Given file may be corrupted.\n";
+
+		return 1;
+	} catch(const Huffman::EncodedMessage::ChecksumMismatchException& e) {
+		if(e.get_block()) {
+			std::cerr << "The block " << *e.get_block() << " doesn't match its checksum. Given file is corrupted.\n";
+		} else {
+			std::cerr << "A block doesn't decode to the content it was encoded from. Given file is corrupted.\n";
+		}
+
+		return 1;
+	} catch(const Huffman::Dictionary::InvalidDictionaryException& e) {
+		std::cerr << "The dictionary file is invalid. Make sure it was made with the train command.\n";
+
+		return 1;
+	} catch(const Huffman::EncodedMessage::MissingDictionaryException& e) {
+		std::cerr << "The file was encoded with the dictionary " << Huffman::Dictionary::format_id(e.get_dictionary_id())
+			<< ". Give it with --dictionary.\n";
+
+		return 1;
+	} catch(const Huffman::EncodedMessage::WrongDictionaryException& e) {
+		std::cerr << "The file was encoded with the dictionary " << Huffman::Dictionary::format_id(e.get_file_dictionary_id())
+			<< ", but the given dictionary is " << Huffman::Dictionary::format_id(e.get_given_dictionary_id()) << ".\n";
+
 		return 1;
 	} catch(const Huffman::EncodedMessage::InvalidFooterException& e) {
 		std::cerr << "Invalid file footer. Expected '" << e.get_expected_footer()
@@ -71,6 +117,14 @@ int main(int argc, const char* argv[]) {
 			<< "by changing the last two characters to '" << e.get_expected_footer()
 			<< "', but an invalid footer suggests a corrupted file.\n";
 
+		return 1;
+	} catch(const std::invalid_argument& e) {
+		std::cerr << e.what() << "\n";
+
+		return 1;
+	} catch(const std::exception& e) {
+		std::cerr << "Something went wrong: " << e.what() << "\n";
+
 		return 1;
 	}
 